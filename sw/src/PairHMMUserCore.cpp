@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <stdexcept>
+#include <omp.h>
 
 #include "PairHMMUserCore.h"
 #include "defines.hpp"
@@ -20,8 +21,60 @@
 
 using namespace fletcher;
 
+RegisterImage::RegisterImage(std::shared_ptr<fletcher::FPGAPlatform> platform)
+        : platform(platform)
+{
+}
+
+void RegisterImage::set(uint64_t offset, fr_t value)
+{
+        if (offset >= REG_IMAGE_SIZE) {
+            // Outside of the image, write through
+            platform->write_mmio(offset, value);
+            writes_total++;
+            return;
+        }
+
+        staged[offset] = value;
+        dirty |= 1ULL << offset;
+}
+
+int RegisterImage::commit()
+{
+        writes_last = 0;
+        skipped_last = 0;
+
+        for (uint64_t offset = 0; offset < REG_IMAGE_SIZE; offset++) {
+            uint64_t bit = 1ULL << offset;
+            if (!(dirty & bit)) {
+                continue;
+            }
+
+            if ((known & bit) && shadow[offset] == staged[offset]) {
+                skipped_last++;
+                continue;
+            }
+
+            platform->write_mmio(offset, staged[offset]);
+            shadow[offset] = staged[offset];
+            known |= bit;
+            writes_last++;
+        }
+
+        dirty = 0;
+        writes_total += writes_last;
+        skipped_total += skipped_last;
+
+        return writes_last;
+}
+
+void RegisterImage::invalidate()
+{
+        known = 0;
+}
+
 PairHMMUserCore::PairHMMUserCore(std::shared_ptr<fletcher::FPGAPlatform> platform)
-        : UserCore(platform)
+        : UserCore(platform), regs(platform)
 {
         // Some settings that are different from standard implementation
         // concerning start, reset and status register.
@@ -39,66 +92,83 @@ PairHMMUserCore::PairHMMUserCore(std::shared_ptr<fletcher::FPGAPlatform> platfor
 }
 
 void PairHMMUserCore::set_batch_offsets(std::vector<uint32_t>& offsets) {
-        for (int i = 0; i < MAX_CORES / 2; i++) {
+        // Only the register pairs of cores that are started
+        for (int i = 0; i < roundToMultiple(CORES, 2) / 2; i++) {
             reg_conv_t reg;
 
-            if(i < CORES) {
-                reg.half.hi = offsets[2 * i];
-                reg.half.lo = offsets[2 * i + 1];
-            } else {
-                reg.half.hi = 0x00000000;
-                reg.half.lo = 0x00000000;
-            }
+            reg.half.hi = offsets[2 * i];
+            reg.half.lo = offsets[2 * i + 1];
 
-            this->platform()->write_mmio(REG_BATCH_OFFSET + i, reg.full);
+            regs.set(REG_BATCH_OFFSET + i, reg.full);
         }
 }
 
 void PairHMMUserCore::set_batch_init(std::vector<uint32_t>& batch_length, std::vector<t_inits>& init, std::vector<uint32_t>& xlen, std::vector<uint32_t>& ylen) {
-    for (int i = 0; i < (int)ceil((float)CORES / 2); i++) {
+    for (int i = 0; i < roundToMultiple(CORES, 2) / 2; i++) {
         reg_conv_t reg;
 
         reg.half.hi = batch_length[2 * i];
         reg.half.lo = batch_length[2 * i + 1];
-        this->platform()->write_mmio(REG_BATCHES_OFFSET + i, reg.full);
+        regs.set(REG_BATCHES_OFFSET + i, reg.full);
 
         reg.half.hi = xlen[2 * i];
         reg.half.lo = xlen[2 * i + 1];
-        this->platform()->write_mmio(REG_XLEN_OFFSET + i, reg.full);
+        regs.set(REG_XLEN_OFFSET + i, reg.full);
 
         reg.half.hi = ylen[2 * i];
         reg.half.lo = ylen[2 * i + 1];
-        this->platform()->write_mmio(REG_YLEN_OFFSET + i, reg.full);
+        regs.set(REG_YLEN_OFFSET + i, reg.full);
 
         reg.half.hi = init[2 * i].x_size;
         reg.half.lo = init[2 * i + 1].x_size;
-        this->platform()->write_mmio(REG_X_OFFSET + i, reg.full);
+        regs.set(REG_X_OFFSET + i, reg.full);
 
         reg.half.hi = init[2 * i].y_size;
         reg.half.lo = init[2 * i + 1].y_size;
-        this->platform()->write_mmio(REG_Y_OFFSET + i, reg.full);
+        regs.set(REG_Y_OFFSET + i, reg.full);
     }
 
     reg_conv_t reg;
 
     reg.half.hi = init[2 * 0].x_padded;
     reg.half.lo = init[2 * 0 + 1].x_padded;
-    this->platform()->write_mmio(REG_XP_OFFSET + 0, reg.full);
+    regs.set(REG_XP_OFFSET + 0, reg.full);
 
     reg.half.hi = init[2 * 0].y_padded;
     reg.half.lo = init[2 * 0 + 1].y_padded;
-    this->platform()->write_mmio(REG_YP_OFFSET + 0, reg.full);
+    regs.set(REG_YP_OFFSET + 0, reg.full);
 
     reg.half.hi = init[2 * 0].x_bppadded;
     reg.half.lo = init[2 * 0 + 1].x_bppadded;
-    this->platform()->write_mmio(REG_XBPP_OFFSET + 0, reg.full);
+    regs.set(REG_XBPP_OFFSET + 0, reg.full);
 
     reg.half.hi = init[2 * 0].initials[0];
     reg.half.lo = init[2 * 0 + 1].initials[0];
-    this->platform()->write_mmio(REG_INITIAL_OFFSET + 0, reg.full);
+    regs.set(REG_INITIAL_OFFSET + 0, reg.full);
+}
+
+void PairHMMUserCore::set_result_buffer(int core, uint64_t address)
+{
+        regs.set(REG_RESULT_DATA_OFFSET + core, address);
 }
 
 void PairHMMUserCore::control_zero()
 {
         this->platform()->write_mmio(REG_CONTROL_OFFSET, 0x00000000);
 }
+
+bool PairHMMUserCore::wait_for_finish(double timeout)
+{
+        double deadline = omp_get_wtime() + timeout;
+        fr_t status = 0;
+
+        do {
+            this->platform()->read_mmio(REG_STATUS_OFFSET, &status);
+            if ((status & done_status_mask) == done_status) {
+                return true;
+            }
+            usleep(10);
+        } while (omp_get_wtime() < deadline);
+
+        return false;
+}
@@ -24,6 +24,7 @@
 #define CORES   1
 #define MAX_CORES 8
 
+#define REG_STATUS_OFFSET   0
 #define REG_CONTROL_OFFSET  1
 
 #define REG_RESULT_DATA_OFFSET 8
@@ -44,6 +45,44 @@
 #define REG_XBPP_OFFSET 42
 #define REG_INITIAL_OFFSET 43
 
+// Number of registers kept in the register image (offsets 0 ... 63)
+#define REG_IMAGE_SIZE 64
+
+/**
+ * \class RegisterImage
+ *
+ * Shadow of the MMIO registers of the UserCore. Values are staged with set()
+ * and commit() only writes the registers whose value differs from the last
+ * value written, in ascending order. The data registers keep their value
+ * across a UserCore reset, so the shadow stays valid between launches.
+ */
+class RegisterImage
+{
+public:
+RegisterImage(std::shared_ptr<fletcher::FPGAPlatform> platform);
+
+void set(uint64_t offset, fletcher::fr_t value);
+
+// Write the staged registers that changed, returns the number of MMIO writes
+int commit();
+
+// Forget the contents of the registers, so that the next commit writes all staged registers
+void invalidate();
+
+// Statistics of the last commit and of all commits
+int writes_last = 0;
+int skipped_last = 0;
+uint64_t writes_total = 0;
+uint64_t skipped_total = 0;
+
+private:
+std::shared_ptr<fletcher::FPGAPlatform> platform;
+fletcher::fr_t shadow[REG_IMAGE_SIZE];
+fletcher::fr_t staged[REG_IMAGE_SIZE];
+uint64_t known = 0;     // Registers of which the shadow holds the current value
+uint64_t dirty = 0;     // Registers that were staged since the last commit
+};
+
 /**
  * \class PairHMMUserCore
  *
@@ -57,13 +96,24 @@ public:
  */
 PairHMMUserCore(std::shared_ptr<fletcher::FPGAPlatform> platform);
 
+// The set_* functions only stage register values; commit them with registers().commit() before start()
 void set_batch_offsets(std::vector<uint32_t>& offsets);
 
 void set_batch_init(std::vector<uint32_t>& batch_length, std::vector<t_inits>& init, std::vector<uint32_t>& xlen, std::vector<uint32_t>& ylen);
 
+void set_result_buffer(int core, uint64_t address);
+
 void control_zero();
 
-private:
+/**
+ * Poll the status register until the cores are done or timeout seconds have
+ * passed. Returns false on a timeout.
+ */
+bool wait_for_finish(double timeout);
 
+RegisterImage& registers() { return regs; }
+
+private:
+RegisterImage regs;
 
 };
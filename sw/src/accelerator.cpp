@@ -0,0 +1,233 @@
+#include <iostream>
+#include <omp.h>
+
+// Apache Arrow
+#include <arrow/api.h>
+
+#include "accelerator.hpp"
+#include "PairHMMUserCore.h"
+#include "scheme.hpp"
+#include "utils.hpp"
+#include "cycle_model.hpp"
+#include "log.hpp"
+
+using namespace std;
+
+SNAPAccelerator::SNAPAccelerator(int card_no, int numa_node, double deadline)
+        : card(card_no), node(numa_node), deadline(deadline), platform(new fletcher::SNAPPlatform(card_no)),
+          uc(static_pointer_cast<fletcher::FPGAPlatform>(platform)) {
+}
+
+std::string SNAPAccelerator::name() const {
+    return "snap" + std::to_string(card);
+}
+
+std::vector<uint32_t> SNAPAccelerator::run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload) {
+    double start, stop;
+
+    LOG_DEBUG(LOG_ACCEL, "[%s] Creating Arrow table...\n", name().c_str());
+    // Burst-aligned column buffers, so Fletcher can pass them to the card as they are
+    AcceleratorMemoryPool column_pool(BURST_LENGTH, true, node);
+
+    start = omp_get_wtime();
+    // Make a table with haplotypes
+    shared_ptr<arrow::Table> table_hapl = create_table_hapl(batches, selection, PACKED_BASES, &column_pool);
+    // Create the read and probabilities columns
+    shared_ptr<arrow::Table> table_reads_reads = create_table_reads_reads(batches, selection, PACKED_BASES, &column_pool);
+    shared_ptr<arrow::Table> table_reads_probs = create_table_reads_probs(batches, selection, &column_pool);
+    stop = omp_get_wtime();
+    t_fill_table = stop - start;
+
+    t_pool_stats pool_stats = column_pool.stats();
+    LOG_DEBUG(LOG_ACCEL, "[%s] Column buffers: %ld bytes in use, %ld bytes peak, %lu allocations (%lu huge), %lu not bound to node %d\n",
+                name().c_str(), (long) pool_stats.bytes_allocated, (long) pool_stats.max_memory,
+                (unsigned long) pool_stats.allocations, (unsigned long) pool_stats.huge_allocations,
+                (unsigned long) pool_stats.bind_failures, node);
+
+    LOG_DEBUG(LOG_ACCEL, "[%s] Preparing column buffers...\n", name().c_str());
+    // Prepare the colummn buffers
+    start = omp_get_wtime();
+    std::vector<std::shared_ptr<arrow::Column> > columns;
+    columns.push_back(table_hapl->column(0));
+    columns.push_back(table_reads_reads->column(0));
+    columns.push_back(table_reads_probs->column(0));
+    if (PACKED_BASES) {
+        // N positions of the packed haplotypes and reads
+        columns.push_back(table_hapl->column(1));
+        columns.push_back(table_reads_reads->column(1));
+    }
+    for (shared_ptr<arrow::Column>& column : columns) {
+        if (!column_aligned(column, BURST_LENGTH)) {
+            LOG_WARN(LOG_ACCEL, "WARNING: column buffer not aligned to %d bytes, it will be copied\n", BURST_LENGTH);
+        }
+    }
+    platform->prepare_column_chunks(columns); // This requires a modification in Fletcher (to accept vectors)
+    stop = omp_get_wtime();
+    t_prepare_column = stop - start;
+
+    LOG_DEBUG(LOG_ACCEL, "[%s] Configuring UserCore...\n", name().c_str());
+    start = omp_get_wtime();
+
+    // Reset UserCore
+    uc.reset();
+
+    // Initial values for each core
+    std::vector<t_inits> inits(roundToMultiple(CORES, 2));
+    // Number of batches for each core, balanced over the cores
+    std::vector<uint32_t> batch_length = core_batch_lengths(workload->batches, CORES, roundToMultiple(CORES, 2));
+    // X & Y length for each core
+    std::vector<uint32_t> x_len(roundToMultiple(CORES, 2));
+    std::vector<uint32_t> y_len(roundToMultiple(CORES, 2));
+
+    for(int i = 0; i < roundToMultiple(CORES, 2); i++) {
+        // For now, duplicate batch information across all core MMIO registers
+        // Runs of the scheduler can have fewer batches than there are cores
+        bool used = i < CORES && i < workload->batches;
+        inits[i] = used ? batches[selection[i]].init : batches[selection[0]].init;
+        x_len[i] = used ? workload->bx[i] : 0;
+        y_len[i] = used ? workload->by[i] : 0;
+    }
+
+    // Write result buffer addresses
+    // Take the result buffers (per SA core) from the arena, with only the words of this run reset
+    std::vector<uint32_t *> result_hw(roundToMultiple(CORES, 2));
+    for(int i = 0; i < roundToMultiple(CORES, 2); i++) {
+        result_hw[i] = result_arena.acquire(roundToMultiple(batch_length[i], 2) * PIPE_DEPTH);
+
+        uc.set_result_buffer(i, (uint64_t) result_hw[i]);
+    }
+    stop = omp_get_wtime();
+    t_create_core = stop - start;
+
+    // Configure the pair HMM SA cores
+    uc.set_batch_init(batch_length, inits, x_len, y_len);
+
+    std::vector<uint32_t> batch_offsets;
+    batch_offsets.resize(roundToMultiple(CORES, 2));
+    int batch_counter = 0;
+    for(int i = 0; i < roundToMultiple(CORES, 2); i++) {
+        batch_offsets[i] = batch_counter;
+        batch_counter = batch_counter + batch_length[i];
+    }
+    uc.set_batch_offsets(batch_offsets);
+
+    // Only write the registers that changed since the previous run
+    mmio_writes = uc.registers().commit();
+    LOG_DEBUG(LOG_ACCEL, "[%s] MMIO writes: %d, unchanged registers skipped: %d\n", name().c_str(),
+                uc.registers().writes_last, uc.registers().skipped_last);
+
+    // Run
+    LOG_DEBUG(LOG_ACCEL, "[%s] Starting accelerator computation...\n", name().c_str());
+    double timeout = deadline > 0.0 ? deadline : WATCHDOG_MIN_TIME + WATCHDOG_SLACK * (double) workload->cups / MAX_CUPS_HW;
+
+    start = omp_get_wtime();
+    uc.start();
+
+    bool finished = uc.wait_for_finish(timeout);
+
+    // Wait for last result of every SA core that has batches
+    for (int i = 0; i < CORES; i++) {
+        while (finished && batch_length[i] > 0 && (result_hw[i][batch_length[i] * PIPE_DEPTH - 1] == RESULT_SENTINEL)) {
+            usleep(1);
+            finished = omp_get_wtime() - start < timeout;
+        }
+    }
+    stop = omp_get_wtime();
+    t_run = stop - start;
+
+    if (!finished) {
+        return recover(batches, selection, workload, result_hw, batch_length, batch_offsets);
+    }
+
+    for(int i = 0; i < CORES; i++) {
+        LOG_TRACE(LOG_ACCEL, "[%s] Results of core %d:\n", name().c_str(), i);
+        for(int j = 0; j < batch_length[i] * PIPE_DEPTH; j++) {
+            LOG_TRACE(LOG_ACCEL, "%d: %x\n", j, result_hw[i][j]);
+        }
+    }
+
+    // Gather the HW results in batch order; each core writes its batches in reverse order
+    std::vector<uint32_t> results(workload->batches * PIPE_DEPTH);
+    for (int c = 0; c < CORES; c++) {
+        for (int i = 0; i < batch_length[c]; i++) {
+            int batch = batch_offsets[c] + (batch_length[c] - i - 1);
+            for(int j = 0; j < PIPE_DEPTH; j++) {
+                results[batch * PIPE_DEPTH + j] = result_hw[c][i * PIPE_DEPTH + j];
+            }
+        }
+    }
+
+    for(int i = 0; i < roundToMultiple(CORES, 2); i++) {
+        result_arena.release(result_hw[i]);
+    }
+
+    LOG_DEBUG(LOG_ACCEL, "[%s] Resetting UserCore...\n", name().c_str());
+    uc.reset();
+
+    return results;
+}
+
+std::vector<uint32_t> SNAPAccelerator::recover(std::vector<t_batch>& batches, const std::vector<int>& selection,
+                                               t_workload *workload, std::vector<uint32_t *>& result_hw, std::vector<uint32_t>& batch_length,
+                                               std::vector<uint32_t>& batch_offsets) {
+    LOG_WARN(LOG_ACCEL, "WARNING: %s missed its deadline after %.3f s, resetting the UserCore\n", name().c_str(), t_run);
+    timeouts++;
+    uc.reset();
+
+    // The registers of a stalled card are unknown, so the next run writes all of them
+    uc.registers().invalidate();
+
+    // Keep what the cores finished; a batch is finished when none of its results is a sentinel
+    std::vector<uint32_t> results(workload->batches * PIPE_DEPTH, RESULT_SENTINEL);
+    std::vector<int> unfinished;
+    for (int c = 0; c < CORES; c++) {
+        for (int i = 0; i < batch_length[c]; i++) {
+            int batch = batch_offsets[c] + (batch_length[c] - i - 1);
+            bool done = true;
+            for (int j = 0; j < PIPE_DEPTH; j++) {
+                results[batch * PIPE_DEPTH + j] = result_hw[c][i * PIPE_DEPTH + j];
+                done = done && results[batch * PIPE_DEPTH + j] != RESULT_SENTINEL;
+            }
+            if (!done) {
+                unfinished.push_back(batch);
+            }
+        }
+    }
+
+    // The result buffers of a stalled card are not recycled: it might still write to them
+    LOG_DEBUG(LOG_ACCEL, "[%s] Computing %d unfinished batches on the host\n", name().c_str(), (int) unfinished.size());
+    fallback_batches += unfinished.size();
+
+    t_workload *sub = select_workload(workload, unfinished);
+    PairHMMPosit engine(sub, false, false);
+    for (size_t i = 0; i < unfinished.size(); i++) {
+        engine.calculate_batch(batches[selection[unfinished[i]]], i);
+    }
+    std::vector<uint32_t> bits = engine.result_bits();
+    for (size_t i = 0; i < unfinished.size(); i++) {
+        std::copy(bits.begin() + i * PIPE_DEPTH, bits.begin() + (i + 1) * PIPE_DEPTH,
+                  results.begin() + unfinished[i] * PIPE_DEPTH);
+    }
+    free_workload(sub);
+
+    return results;
+}
+
+EmulatedAccelerator::EmulatedAccelerator(int id, double cups)
+        : id(id), cups(cups) {
+}
+
+std::string EmulatedAccelerator::name() const {
+    return "emu" + std::to_string(id);
+}
+
+std::vector<uint32_t> EmulatedAccelerator::run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload) {
+    double start = omp_get_wtime();
+    PairHMMPosit engine(workload, false, false);
+    for (size_t i = 0; i < selection.size(); i++) {
+        engine.calculate_batch(batches[selection[i]], i);
+    }
+    t_run = omp_get_wtime() - start;
+
+    return engine.result_bits();
+}
@@ -0,0 +1,112 @@
+#ifndef __ACCELERATOR_H
+#define __ACCELERATOR_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Fletcher
+#include <fletcher/fletcher.h>
+
+#include "defines.hpp"
+#include "batch.hpp"
+#include "result_arena.hpp"
+#include "memory_pool.hpp"
+#include "PairHMMUserCore.h"
+
+// Clock frequency of the accelerator and the peak throughput of one card
+#define FREQ_HW                  125e6
+#define MAX_CUPS_HW              (FREQ_HW * (double)PES)
+
+// Without a configured deadline, a job may take this long plus WATCHDOG_SLACK
+// times its time at peak throughput before the watchdog gives up on the card
+#define WATCHDOG_MIN_TIME        5.0
+#define WATCHDOG_SLACK           10.0
+
+/**
+ * A platform that computes batches of pairs: a card, or an emulation of one.
+ */
+class Accelerator {
+public:
+    virtual ~Accelerator() = default;
+
+    virtual std::string name() const = 0;
+
+    // Expected throughput in cell updates (PE-cycles of the cycle model) per second,
+    // used to balance the work between platforms
+    virtual double throughput() const { return MAX_CUPS_HW; }
+
+    /**
+     * Compute all pairs of the batches selected by index; workload is that of
+     * the selection (see select_workload). The batches are not copied. Returns
+     * the raw posit results in the order of the selection (i * PIPE_DEPTH + pair).
+     */
+    virtual std::vector<uint32_t> run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload) = 0;
+
+    // Timings of the last run
+    double t_fill_table = 0.0;
+    double t_prepare_column = 0.0;
+    double t_create_core = 0.0;
+    double t_run = 0.0;
+
+    // MMIO register writes of the last run
+    uint64_t mmio_writes = 0;
+
+    // Watchdog events since the platform was created: runs that missed their
+    // deadline, and the batches of those runs that were computed on the host
+    int timeouts = 0;
+    int fallback_batches = 0;
+};
+
+class SNAPAccelerator : public Accelerator {
+public:
+    /**
+     * \param deadline  Seconds a job may take before the card is reset and its
+     *                  unfinished batches are computed on the host. Zero
+     *                  derives the deadline from the size of each job.
+     */
+    SNAPAccelerator(int card_no = 0, int numa_node = NUMA_NODE_ANY, double deadline = 0.0);
+
+    std::string name() const override;
+
+    std::vector<uint32_t> run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload) override;
+
+private:
+    int card;
+    int node;
+    double deadline;
+    std::shared_ptr<fletcher::SNAPPlatform> platform;
+
+    // Kept for the lifetime of the card, so that its register image only
+    // rewrites the registers that changed since the previous run
+    PairHMMUserCore uc;
+
+    // Result buffers of this card, recycled across runs
+    ResultArena result_arena;
+
+    // Reset the card after a missed deadline and compute the unfinished batches on the host
+    std::vector<uint32_t> recover(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload,
+                                  std::vector<uint32_t *>& result_hw,
+                                  std::vector<uint32_t>& batch_length, std::vector<uint32_t>& batch_offsets);
+};
+
+/**
+ * Computes the batches on the host with the posit reference engine, so that
+ * multi-platform runs can be tested without hardware.
+ */
+class EmulatedAccelerator : public Accelerator {
+public:
+    EmulatedAccelerator(int id = 0, double cups = MAX_CUPS_HW);
+
+    std::string name() const override;
+    double throughput() const override { return cups; }
+
+    std::vector<uint32_t> run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload) override;
+
+private:
+    int id;
+    double cups;
+};
+
+#endif //__ACCELERATOR_H
@@ -0,0 +1,45 @@
+#include <algorithm>
+
+#include "bases.hpp"
+
+void PackedBases::resize(size_t n) {
+    length = n;
+    words.resize((n + BASES_PER_WORD - 1) / BASES_PER_WORD, 0);
+    n_pos.erase(std::lower_bound(n_pos.begin(), n_pos.end(), (uint32_t) n), n_pos.end());
+}
+
+void PackedBases::set(size_t i, unsigned char base) {
+    uint64_t shift = 2 * (i % BASES_PER_WORD);
+    uint64_t& word = words[i / BASES_PER_WORD];
+    word = (word & ~((uint64_t) 0x3 << shift)) | ((uint64_t) base_to_code(base) << shift);
+
+    // Sequences are mostly filled front to back, so appending is the common case
+    bool n = (base == 'N');
+    if (n && (n_pos.empty() || n_pos.back() < i)) {
+        n_pos.push_back((uint32_t) i);
+        return;
+    }
+
+    auto it = std::lower_bound(n_pos.begin(), n_pos.end(), (uint32_t) i);
+    bool present = (it != n_pos.end() && *it == i);
+    if (n && !present) {
+        n_pos.insert(it, (uint32_t) i);
+    } else if (!n && present) {
+        n_pos.erase(it);
+    }
+}
+
+bool PackedBases::is_n(size_t i) const {
+    return !n_pos.empty() && std::binary_search(n_pos.begin(), n_pos.end(), (uint32_t) i);
+}
+
+void PackedBases::unpack_onehot(size_t from, size_t len, uint8_t *out) const {
+    for (size_t k = 0; k < len; k++) {
+        out[k] = (uint8_t) (1 << code(from + k));
+    }
+
+    for (auto it = std::lower_bound(n_pos.begin(), n_pos.end(), (uint32_t) from);
+         it != n_pos.end() && *it < from + len; ++it) {
+        out[*it - from] = ONEHOT_N;
+    }
+}
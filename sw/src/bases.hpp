@@ -0,0 +1,85 @@
+#ifndef __BASES_H
+#define __BASES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// 2-bit base codes
+#define BASE_A           0
+#define BASE_C           1
+#define BASE_G           2
+#define BASE_T           3
+
+// Bases per 64-bit word of a packed sequence
+#define BASES_PER_WORD   32
+
+// One-hot (4-bit) base codes, used by the host kernels to compare bases with
+// a single AND: (read & hapl) != 0 is a match, and N matches every base.
+#define ONEHOT_N         0xF
+
+inline uint8_t base_to_code(unsigned char base) {
+    switch (base) {
+        case 'A': return BASE_A;
+        case 'C': return BASE_C;
+        case 'G': return BASE_G;
+        case 'T': return BASE_T;
+        default:  return BASE_A; // Ns are kept in the N mask
+    }
+}
+
+inline unsigned char code_to_base(uint8_t code) {
+    return "ACGT"[code & 0x3];
+}
+
+/**
+ * A base sequence stored with 2 bits per base, plus a sparse, sorted list of
+ * the positions that hold an N.
+ *
+ * Words are little-endian with base i in bits 2*(i%32) of word i/32, so the
+ * raw words are also a byte stream with 4 bases per byte, base i in bits
+ * 2*(i%4) of byte i/4. This is the layout of the packed Arrow columns.
+ */
+class PackedBases {
+private:
+    std::vector<uint64_t> words;
+    std::vector<uint32_t> n_pos;
+    size_t length = 0;
+
+public:
+    PackedBases() = default;
+
+    void resize(size_t n);
+
+    size_t size() const { return length; }
+
+    void set(size_t i, unsigned char base);
+
+    uint8_t code(size_t i) const {
+        return (uint8_t) ((words[i / BASES_PER_WORD] >> (2 * (i % BASES_PER_WORD))) & 0x3);
+    }
+
+    bool is_n(size_t i) const;
+
+    unsigned char at(size_t i) const {
+        return is_n(i) ? 'N' : code_to_base(code(i));
+    }
+
+    uint8_t onehot(size_t i) const {
+        return is_n(i) ? ONEHOT_N : (uint8_t) (1 << code(i));
+    }
+
+    // Expand len bases starting at position from into one-hot codes
+    void unpack_onehot(size_t from, size_t len, uint8_t *out) const;
+
+    const std::vector<uint64_t>& data() const { return words; }
+
+    const std::vector<uint32_t>& n_positions() const { return n_pos; }
+
+    // Number of bytes of the packed byte stream (4 bases per byte)
+    size_t packed_bytes() const { return (length + 3) / 4; }
+
+    const uint8_t *packed() const { return reinterpret_cast<const uint8_t *>(words.data()); }
+};
+
+#endif //__BASES_H
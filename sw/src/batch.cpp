@@ -1,30 +1,92 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include <posit/posit>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 #include "batch.hpp"
 #include "utils.hpp"
 #include "defines.hpp"
+#include "rng.hpp"
+#include "log.hpp"
 
 using namespace std;
 using namespace sw::unum;
 
-posit<NBITS, ES> random_number(float offset, float dev) {
-    float num_float;
-    posit<NBITS, 2> num_posit_2;
-    posit<NBITS, 3> num_posit_3;
+// Round a probability to a float that is exactly representable in both
+// posit<NBITS, 2> and posit<NBITS, 3>, so every bitstream and host engine
+// sees the same value, and return it as raw posit<NBITS, ES> bits.
+uint32_t exact_prob(double p) {
+    float f = (float) p;
+    uint32_t f_bits;
+    memcpy(&f_bits, &f, sizeof(f));
+
+    for (int drop = 0; drop < 23; drop++) {
+        uint32_t bits = f_bits & ~((1u << drop) - 1);
+        float g;
+        memcpy(&g, &bits, sizeof(g));
+
+        posit<NBITS, 2> num_posit_2(g);
+        posit<NBITS, 3> num_posit_3(g);
+        if (num_posit_2 == g && num_posit_3 == g) {
+            f = g;
+            break;
+        }
+    }
+
+    return to_uint(posit<NBITS, ES>(f));
+}
 
-    do {
-        num_float = offset + (rand() * dev / RAND_MAX);
-        num_posit_2 = num_float;
-        num_posit_3 = num_float;
-    } while (num_posit_2 != num_float || num_posit_3 != num_float);
+double qual_to_prob(int qual) {
+    return pow(10.0, -qual / 10.0);
+}
 
-    return posit<NBITS, ES>(num_float);
+// Quality to raw posit probability lookup tables
+typedef struct struct_prob_tables {
+    uint32_t match[MAX_QUAL];               // 1 - p(base error)
+    uint32_t mismatch[MAX_QUAL];            // p(base error) / 3
+    uint32_t gap[MAX_QUAL];                 // p(gap)
+    uint32_t gap_end[MAX_QUAL];             // 1 - p(gap continuation)
+    uint32_t m2m[MAX_QUAL][MAX_QUAL];       // 1 - (p(ins) + p(del))
+} t_prob_tables;
+
+const t_prob_tables& prob_tables() {
+    static const t_prob_tables tables = [] {
+        t_prob_tables t;
+        for (int q = 0; q < MAX_QUAL; q++) {
+            t.match[q] = exact_prob(1.0 - qual_to_prob(q));
+            t.mismatch[q] = exact_prob(qual_to_prob(q) / 3.0);
+            t.gap[q] = exact_prob(qual_to_prob(q));
+            t.gap_end[q] = exact_prob(1.0 - qual_to_prob(q));
+            for (int r = 0; r < MAX_QUAL; r++) {
+                t.m2m[q][r] = exact_prob(fmax(0.0, 1.0 - (qual_to_prob(q) + qual_to_prob(r))));
+            }
+        }
+        return t;
+    }();
+    return tables;
+}
+
+void expand_probs(const t_quals& qual, t_probs& probs) {
+    const t_prob_tables& t = prob_tables();
+
+    int base = min((int) qual.base, MAX_QUAL - 1);
+    int ins = min((int) qual.ins, MAX_QUAL - 1);
+    int del = min((int) qual.del, MAX_QUAL - 1);
+    int gcp = min((int) qual.gcp, MAX_QUAL - 1);
+
+    probs.p[0].b = t.gap[gcp];           // eta (D -> D)
+    probs.p[1].b = t.gap[del];           // zeta (M -> D)
+    probs.p[2].b = t.gap[gcp];           // epsilon (I -> I)
+    probs.p[3].b = t.gap[ins];           // delta (M -> I)
+    probs.p[4].b = t.gap_end[gcp];       // beta (I -> M, D -> M)
+    probs.p[5].b = t.m2m[ins][del];      // alpha (M -> M)
+    probs.p[6].b = t.mismatch[base];     // distm_diff
+    probs.p[7].b = t.match[base];        // distm_simi
 }
 
 uint32_t getProb(unsigned char rb) {
@@ -44,20 +106,22 @@ uint32_t getProb(unsigned char rb) {
     return 0x38741A00;
 }
 
-void fill_batch(t_batch& batch, string& x_string, string& y_string, int batch_num, int x, int y, float initial) {
+void fill_batch(t_batch& batch, int batch_num, int x, int y, float initial, int read_id, int hapl_variants) {
     t_inits& init = batch.init;
-    std::vector<t_bbase>& read = batch.read;
-    std::vector<t_bbase>& hapl = batch.hapl;
-    std::vector<t_probs>& prob = batch.prob;
+    PackedBases& read = batch.read;
+    PackedBases& hapl = batch.hapl;
+    std::vector<t_quals>& qual = batch.qual;
 
     int xp = px(x, y); // Padded read size
     int xbp = pbp(xp); // Padded base pair (how many reads)
     int yp = py(y); // Padded haplotype size
     int ybp = pbp(yp); // Padded base pair (how many haplos)
 
-    read.resize(xp + x - 1); prob.resize(xp + x - 1); // TODO correct?
+    read.resize(xp + x - 1); qual.resize(xp + x - 1); // TODO correct?
     hapl.resize(yp + y - 1);
-    // hapl.resize(yp);
+
+    // The read and its qualities are drawn by read, the haplotype by batch
+    batch.read_id = read_id < 0 ? batch_num : read_id;
 
     init.x_size = xp;
     init.x_padded = xp;
@@ -65,33 +129,18 @@ void fill_batch(t_batch& batch, string& x_string, string& y_string, int batch_nu
     init.y_size = yp;
     init.y_padded = ybp;
 
-    std::array<posit<NBITS, ES>, 99> zeta, eta, epsilon, delta, beta, alpha, distm_diff, distm_simi;
     for (int i = 0; i < xp + x - 1; i++) {
-        srand((i) * xp + x * 9949 + y * 9133); // Seed number generator
-
-        eta[i] = random_number(0.5, 0.1);
-        zeta[i] = random_number(0.125, 0.05);
-        epsilon[i] = random_number(0.5, 0.1);
-        delta[i] = random_number(0.125, 0.05);
-        beta[i] = random_number(0.5, 0.1);
-        alpha[i] = random_number(0.125, 0.05);//cout << x_string[batch_num * (xp + x - 1) + i] << " - " << hexstring(alpha[i].collect()) << endl;
-        distm_diff[i] = random_number(0.5, 0.1);
-        distm_simi[i] = random_number(0.125, 0.05);
-
-        // eta[i].set_raw_bits((getProb(x_string[batch_num * (xp + x - 1) + i]))); cout << x_string[batch_num * (xp + x - 1) + i] << " - " << hexstring(eta[i].collect()) << endl;
-        // zeta[i].set_raw_bits((getProb(x_string[batch_num * (xp + x - 1) + i])));
-        // epsilon[i].set_raw_bits((getProb(x_string[batch_num * (xp + x - 1) + i])));
-        // delta[i].set_raw_bits((getProb(x_string[batch_num * (xp + x - 1) + i])));
-        // beta[i].set_raw_bits((getProb(x_string[batch_num * (xp + x - 1) + i])));
-        // alpha[i].set_raw_bits((getProb(x_string[batch_num * (xp + x - 1) + i])));
-        // distm_diff[i].set_raw_bits((getProb(x_string[batch_num * (xp + x - 1) + i])));
-        // distm_simi[i].set_raw_bits((getProb(x_string[batch_num * (xp + x - 1) + i])));
+        CounterRNG rng(batch.read_id, RNG_PROBS, i);
+
+        qual[i].base = 10 + rng.bits(0) % 31;  // 10 ... 40
+        qual[i].ins = 25 + rng.bits(1) % 21;   // 25 ... 45
+        qual[i].del = 25 + rng.bits(2) % 21;   // 25 ... 45
+        qual[i].gcp = 8 + rng.bits(3) % 5;     //  8 ... 12
     }
-    cout << endl;
 
     posit<NBITS, ES> initial_posit(initial / yp);
 
-    cout << "INITIAL: "  << hexstring(initial_posit.collect()) << endl;
+    LOG_TRACE(LOG_BATCH, "INITIAL: %s\n", hexstring(initial_posit.collect()).c_str());
 
     // Get raw bits to send to HW
     for(int k = 0; k < PIPE_DEPTH; k++) {
@@ -99,45 +148,25 @@ void fill_batch(t_batch& batch, string& x_string, string& y_string, int batch_nu
     }
 
     for (int i = 0; i < xp + x - 1; i++) {
-        read[i].base = x_string[batch_num * (xp + x - 1) + i];
-    }
-
-    for (int i = 0; i < yp + y - 1; i++) {
-    // for (int i = 0; i < yp; i++) {
-        hapl[i].base = y_string[batch_num * (yp + y - 1) + i];
-        // hapl[i].base = y_string[batch_num * (yp) + i];
-    }
-
-    for (int i = 0; i < xp + x - 1; i++) {
-        prob[i].p[0].b = (int) eta[i].collect().to_ulong();
-        prob[i].p[1].b = (int) zeta[i].collect().to_ulong();
-        prob[i].p[2].b = (int) epsilon[i].collect().to_ulong();
-        prob[i].p[3].b = (int) delta[i].collect().to_ulong();
-        prob[i].p[4].b = (int) beta[i].collect().to_ulong();
-        prob[i].p[5].b = (int) alpha[i].collect().to_ulong();
-        prob[i].p[6].b = (int) distm_diff[i].collect().to_ulong();
-        prob[i].p[7].b = (int) distm_simi[i].collect().to_ulong();
+        read.set(i, random_base(batch.read_id, RNG_READ_BASES, i));
     }
-} // fill_batch
 
-int batchToCore(int batch, std::vector<uint32_t>& batch_offsets) {
-    int core = 0;
-    for(uint32_t& offset : batch_offsets) {
-        if(batch < offset) {
-            return core - 1;
+    if (hapl_variants > 0) {
+        for (int i = 0; i < yp + y - 1; i++) {
+            hapl.set(i, random_base(batch.read_id, RNG_HAPL_BASES, i));
         }
-        core++;
-    }
-    return -1;
-}
-
-int batchToCoreBatch(int batch, std::vector<uint32_t>& batch_length) {
-    int batch_rem = batch;
-    for(uint32_t& length : batch_length) {
-        if(length >= batch_rem) {
-            return batch_rem;
+        // Every variant substitutes one of the three other bases, drawn independently of its position
+        const char charset[] = "ACTG";
+        for (int v = 0; v < hapl_variants; v++) {
+            CounterRNG rng(batch_num, RNG_HAPL_VARIANTS, v);
+            int pos = rng.bits(0) % (yp + y - 1);
+            const char *base = strchr(charset, hapl.at(pos));
+            int current = base != NULL && *base != '\0' ? base - charset : 0;
+            hapl.set(pos, charset[(current + 1 + rng.bits(1) % 3) & 3]);
+        }
+    } else {
+        for (int i = 0; i < yp + y - 1; i++) {
+            hapl.set(i, random_base(batch_num, RNG_HAPL_BASES, i));
         }
-        batch_rem = batch_rem - length;
     }
-    return -1;
-}
+} // fill_batch
@@ -10,6 +10,7 @@
 #include <posit/posit>
 
 #include "defines.hpp"
+#include "bases.hpp"
 
 using namespace sw::unum;
 
@@ -37,9 +38,18 @@ typedef struct struct_probs {
     t_prob p[8];        // lambda_1, lambda_2, alpha, beta, delta, upsilon, zeta, eta
 } t_probs;
 
-typedef struct struct_bbase {
-    unsigned char base;
-} t_bbase;
+// Qualities are clamped to 0 ... MAX_QUAL - 1
+#define MAX_QUAL 64
+
+// Phred-scaled qualities of one read position (4 bytes instead of the 32 of
+// t_probs). They are expanded to posit probabilities only when a batch is
+// staged for the accelerator or consumed by a host kernel.
+typedef struct struct_quals {
+    uint8_t base;       // base call quality
+    uint8_t ins;        // insertion (gap open) quality
+    uint8_t del;        // deletion (gap open) quality
+    uint8_t gcp;        // gap continuation quality
+} t_quals;
 
 // Initial values and batch configuration
 typedef struct struct_init {
@@ -54,16 +64,25 @@ typedef struct struct_init {
 } t_inits;
 
 typedef struct struct_batch {
+    int read_id = -1;           // Batches with the same read_id share their read bases and qualities
     t_inits init;
-    std::vector<t_bbase> read;
-    std::vector<t_bbase> hapl;
-    std::vector<t_probs> prob;
+    PackedBases read;
+    PackedBases hapl;
+    std::vector<t_quals> qual;
 } t_batch;
 
-void fill_batch(t_batch& batch, string& x_string, string& y_string, int batch_num, int x, int y, float initial);
+void expand_probs(const t_quals& qual, t_probs& probs);
 
-int batchToCore(int batch, std::vector<uint32_t>& batch_offsets);
+// Read of a batch when batches are formed read-major: consecutive groups of
+// haplotypes_per_read batches are all aligned against the same read
+inline int read_major_id(int batch_num, int haplotypes_per_read) {
+    return batch_num / haplotypes_per_read;
+}
 
-int batchToCoreBatch(int batch, std::vector<uint32_t>& batch_length);
+// A negative read_id gives the batch a read of its own (read_id = batch_num).
+// With hapl_variants > 0 the haplotype is a candidate of the read: the read's
+// haplotype with that many substituted bases, so the candidates of one read
+// share long prefixes as in an active region.
+void fill_batch(t_batch& batch, int batch_num, int x, int y, float initial, int read_id = -1, int hapl_variants = 0);
 
 #endif //__BATCH_H
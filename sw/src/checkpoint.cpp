@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+#include "checkpoint.hpp"
+#include "log.hpp"
+
+// FNV-1a over the record up to its checksum
+static uint32_t record_checksum(const t_checkpoint_record& record) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&record);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(t_checkpoint_record, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+t_checkpoint_record checkpoint_record(int engine, int batch) {
+    t_checkpoint_record record;
+    memset(&record, 0, sizeof(record));
+    record.engine = engine;
+    record.batch = batch;
+    return record;
+}
+
+Checkpoint::~Checkpoint() {
+    if (fd >= 0) {
+        sync();
+        close(fd);
+    }
+    if (map != nullptr) {
+        munmap(map, map_bytes);
+    }
+}
+
+bool Checkpoint::open(const std::string& filename, const t_checkpoint_run& run, int batches) {
+    this->batches = batches;
+
+    t_checkpoint_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.record_bytes = sizeof(t_checkpoint_record);
+    header.run = run;
+
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR(LOG_MAIN, "ERROR: could not open checkpoint %s: %s\n", filename.c_str(), strerror(errno));
+        return false;
+    }
+
+    for (int e = 0; e < CHECKPOINT_ENGINES; e++) {
+        index[e].assign(batches, nullptr);
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+
+    if ((size_t) st.st_size < sizeof(header)) {
+        // New file, or one that died before its header was written
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header) || fdatasync(fd) != 0) {
+            LOG_ERROR(LOG_MAIN, "ERROR: could not write checkpoint %s: %s\n", filename.c_str(), strerror(errno));
+            close(fd);
+            fd = -1;
+            return false;
+        }
+    } else {
+        t_checkpoint_header existing;
+        if (pread(fd, &existing, sizeof(existing), 0) != (ssize_t) sizeof(existing) || memcmp(&existing, &header, sizeof(header)) != 0) {
+            LOG_ERROR(LOG_MAIN, "ERROR: checkpoint %s is of another run or format; remove it to start over\n", filename.c_str());
+            close(fd);
+            fd = -1;
+            return false;
+        }
+
+        size_t records = (st.st_size - sizeof(header)) / sizeof(t_checkpoint_record);
+        if (records > 0) {
+            map_bytes = sizeof(header) + records * sizeof(t_checkpoint_record);
+            map = mmap(NULL, map_bytes, PROT_READ, MAP_SHARED, fd, 0);
+            if (map == MAP_FAILED) {
+                map = nullptr;
+                LOG_ERROR(LOG_MAIN, "ERROR: could not map checkpoint %s: %s\n", filename.c_str(), strerror(errno));
+                close(fd);
+                fd = -1;
+                return false;
+            }
+        }
+
+        // Records up to the first torn or unknown one; later ones are cut off
+        for (mapped_records = 0; mapped_records < records; mapped_records++) {
+            const t_checkpoint_record& r = reinterpret_cast<const t_checkpoint_record *>((const uint8_t *) map + sizeof(header))[mapped_records];
+            if (r.checksum != record_checksum(r) || r.engine >= CHECKPOINT_ENGINES || r.batch >= (uint32_t) batches) {
+                break;
+            }
+            index[r.engine][r.batch] = &r;
+        }
+
+        off_t valid = sizeof(header) + mapped_records * sizeof(t_checkpoint_record);
+        if (valid < st.st_size) {
+            LOG_WARN(LOG_MAIN, "Checkpoint %s: cutting off %ld bytes after %zu records\n", filename.c_str(), (long) (st.st_size - valid), mapped_records);
+            if (ftruncate(fd, valid) != 0) {
+                LOG_ERROR(LOG_MAIN, "ERROR: could not truncate checkpoint %s: %s\n", filename.c_str(), strerror(errno));
+                close(fd);
+                fd = -1;
+                return false;
+            }
+        }
+    }
+
+    lseek(fd, 0, SEEK_END);
+    last_sync = omp_get_wtime();
+    return true;
+}
+
+const t_checkpoint_record *Checkpoint::find(int engine, int batch) const {
+    return fd >= 0 ? index[engine][batch] : nullptr;
+}
+
+std::vector<int> Checkpoint::pending(int engine) const {
+    std::vector<int> result;
+    for (int b = 0; b < batches; b++) {
+        if (find(engine, b) == nullptr) {
+            result.push_back(b);
+        }
+    }
+    return result;
+}
+
+void Checkpoint::append(t_checkpoint_record record) {
+    record.checksum = record_checksum(record);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(record);
+    if (queue.size() >= CHECKPOINT_SYNC_RECORDS || omp_get_wtime() - last_sync >= CHECKPOINT_SYNC_SECONDS) {
+        write_queue();
+        fdatasync(fd);
+        last_sync = omp_get_wtime();
+    }
+}
+
+void Checkpoint::sync() {
+    if (fd < 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    write_queue();
+    fdatasync(fd);
+    last_sync = omp_get_wtime();
+}
+
+void Checkpoint::write_queue() {
+    if (fd < 0 || queue.empty()) {
+        return;
+    }
+
+    // A write that dies halfway leaves a partial record, which the next resume cuts off
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(queue.data());
+    size_t bytes = queue.size() * sizeof(t_checkpoint_record);
+    while (bytes > 0) {
+        ssize_t written = write(fd, data, bytes);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR(LOG_MAIN, "ERROR: could not append to checkpoint: %s\n", strerror(errno));
+            break;
+        }
+        data += written;
+        bytes -= written;
+    }
+    queue.clear();
+}
@@ -0,0 +1,153 @@
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/multiprecision/cpp_dec_float.hpp>
+
+#include "defines.hpp"
+
+using boost::multiprecision::cpp_dec_float_100;
+
+#define CHECKPOINT_MAGIC         "PHMMCKPT"
+#define CHECKPOINT_VERSION       2
+
+// Engines whose batch results are checkpointed
+#define CHECKPOINT_HW            0
+#define CHECKPOINT_POSIT         1
+#define CHECKPOINT_FLOAT         2
+#define CHECKPOINT_REFERENCE     3
+#define CHECKPOINT_P16           4
+#define CHECKPOINT_P8            5
+#define CHECKPOINT_TILED         6
+#define CHECKPOINT_ENGINES       7
+
+// Default number of batches per accelerator run when checkpointing
+#define CHECKPOINT_INTERVAL      1024
+
+// Appended records are written and synced to disk after this many records or seconds
+#define CHECKPOINT_SYNC_RECORDS  256
+#define CHECKPOINT_SYNC_SECONDS  10.0
+
+// Everything the results of a run depend on; a checkpoint only resumes the same run
+typedef struct struct_checkpoint_run {
+    uint64_t pairs;
+    uint32_t x;
+    uint32_t y;
+    int32_t initial_constant_power;
+    int32_t haplotypes_per_read;
+    int32_t hapl_variants;
+    int32_t band_width;
+    int32_t band_offset;
+    uint32_t posit_nbits;
+    uint32_t posit_es;
+    uint32_t small_es;              // P16_ES << 16 | P8_ES
+    uint32_t reserved;
+} t_checkpoint_run;
+
+typedef struct struct_checkpoint_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_bytes;
+    t_checkpoint_run run;
+} t_checkpoint_header;
+
+/**
+ * Results of one engine for one batch. What the two words per pair hold
+ * depends on the engine:
+ *  - CHECKPOINT_HW, CHECKPOINT_TILED: the raw posit result.
+ *  - CHECKPOINT_POSIT: the raw posit result, and the raw M sum << 32 | the raw I sum.
+ *  - CHECKPOINT_FLOAT, CHECKPOINT_REFERENCE: the result as the sum of two doubles.
+ *  - CHECKPOINT_P16, CHECKPOINT_P8: the decoded result as a double.
+ */
+typedef struct struct_checkpoint_record {
+    uint32_t engine;
+    uint32_t batch;
+    uint64_t values[PIPE_DEPTH][2];
+    uint32_t checksum;              // Of the bytes before it; a torn last record does not match
+    uint32_t reserved;
+} t_checkpoint_record;
+
+inline uint64_t double_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double bits_double(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// A value as the sum of two doubles (about 32 significant digits), and back
+inline void split_value(const cpp_dec_float_100& value, uint64_t words[2]) {
+    double hi = static_cast<double>(value);
+    words[0] = double_bits(hi);
+    words[1] = double_bits(static_cast<double>(value - cpp_dec_float_100(hi)));
+}
+
+inline cpp_dec_float_100 join_value(const uint64_t words[2]) {
+    return cpp_dec_float_100(bits_double(words[0])) + cpp_dec_float_100(bits_double(words[1]));
+}
+
+/**
+ * Append-only file of completed batch results, so a run that dies can be
+ * resumed where it stopped. The file is a fixed header followed by
+ * fixed-size records; it can be mapped and indexed as an array of
+ * t_checkpoint_record.
+ *
+ * When an existing file of the same run is opened, its records are mapped
+ * and indexed, and a torn record at the end is cut off. The engines restore
+ * the batches it has and compute only the others, appending their results.
+ */
+class Checkpoint {
+public:
+    Checkpoint() = default;
+    ~Checkpoint();
+
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    // Create the file, or resume it; false (with a message) if it cannot be used for this run
+    bool open(const std::string& filename, const t_checkpoint_run& run, int batches);
+
+    bool is_open() const { return fd >= 0; }
+
+    // Record of a batch in the file as it was opened, or nullptr if the batch has to be computed
+    const t_checkpoint_record *find(int engine, int batch) const;
+
+    // Batches of an engine that are not in the file, in order
+    std::vector<int> pending(int engine) const;
+
+    // Records of the file when it was opened
+    size_t restored() const { return mapped_records; }
+
+    // Queue a record; queued records are written out periodically
+    void append(t_checkpoint_record record);
+
+    // Write the queued records and wait until they are on disk
+    void sync();
+
+private:
+    int fd = -1;
+    int batches = 0;
+    void *map = nullptr;
+    size_t map_bytes = 0;
+    size_t mapped_records = 0;
+    std::vector<const t_checkpoint_record *> index[CHECKPOINT_ENGINES];
+
+    std::mutex mutex;
+    std::vector<t_checkpoint_record> queue;
+    double last_sync = 0.0;
+
+    void write_queue();
+};
+
+t_checkpoint_record checkpoint_record(int engine, int batch);
+
+#endif //__CHECKPOINT_H
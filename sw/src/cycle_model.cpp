@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#include "cycle_model.hpp"
+#include "accelerator.hpp"
+#include "utils.hpp"
+
+t_batch_cycles batch_cycles(t_workload *workload, int batch, int pes) {
+    uint64_t x = workload->bx[batch];
+    uint64_t y = workload->by[batch];
+    uint64_t rows = px(x, y, pes);
+    uint64_t cols = py(y, pes);
+    uint64_t x_padded = std::max(x, (uint64_t) pes);
+    uint64_t passes = 1 + ((int64_t) y - 1) / pes;   // PASSES(y) of this array
+    uint64_t drain = pes;                               // CYCLES_BATCH_DRAIN of this array
+
+    t_batch_cycles c;
+    c.useful = 0;
+    for (int p = 0; p < PIPE_DEPTH; p++) {
+        c.useful += (uint64_t) workload->read[batch * PIPE_DEPTH + p] * workload->hapl[batch * PIPE_DEPTH + p];
+    }
+    c.ragged = PIPE_DEPTH * x * y - c.useful;
+    c.pad_y = PIPE_DEPTH * x * (cols - y);
+    c.pad_x = PIPE_DEPTH * (x_padded - x) * cols;
+    c.fifo = PIPE_DEPTH * (rows - x_padded) * cols;
+    c.overhead = (CYCLES_BATCH_LOAD + drain) * pes;
+    c.cycles = passes * rows * PIPE_DEPTH + CYCLES_BATCH_LOAD + drain;
+
+    return c;
+}
+
+double batch_cost(t_workload *workload, int batch) {
+    return (double) batch_cycles(workload, batch).cycles * PES;
+}
+
+std::vector<uint32_t> core_batch_lengths(int batches, int cores, int slots) {
+    std::vector<uint32_t> lengths(slots, 0);
+
+    // The first batches % cores cores get one batch more; the padding slots none
+    for (int i = 0; i < cores && i < slots; i++) {
+        lengths[i] = batches / cores + (i < batches % cores);
+    }
+
+    return lengths;
+}
+
+t_cycle_report predict_cycles(t_workload *workload, int cores) {
+    t_cycle_report r;
+    r.cores = cores;
+    r.cycles = 0;
+    r.total.cycles = r.total.useful = r.total.ragged = r.total.pad_x = r.total.fifo = r.total.pad_y = r.total.overhead = 0;
+    r.t_measured = r.t_host = 0.0;
+
+    std::vector<uint32_t> lengths = core_batch_lengths(workload->batches, cores, cores);
+    std::vector<uint64_t> core_cycles(cores, 0);
+
+    int offset = 0;
+    for (int c = 0; c < cores; c++) {
+        for (uint32_t i = 0; i < lengths[c] && offset < workload->batches; i++, offset++) {
+            t_batch_cycles b = batch_cycles(workload, offset);
+            core_cycles[c] += b.cycles;
+            r.total.cycles += b.cycles;
+            r.total.useful += b.useful;
+            r.total.ragged += b.ragged;
+            r.total.pad_x += b.pad_x;
+            r.total.fifo += b.fifo;
+            r.total.pad_y += b.pad_y;
+            r.total.overhead += b.overhead;
+        }
+        r.cycles = std::max(r.cycles, core_cycles[c]);
+    }
+
+    r.imbalance = 0;
+    for (int c = 0; c < cores; c++) {
+        r.imbalance += (r.cycles - core_cycles[c]) * PES;
+    }
+    r.t_predicted = (double) r.cycles / FREQ_HW;
+
+    return r;
+}
+
+void print_cycle_reports(const std::vector<t_cycle_report>& reports, std::ostream& out) {
+    out << "card,cores,cycles,t_predicted,t_measured,t_host,efficiency,ragged,pad_x,fifo,pad_y,overhead,imbalance,stalls" << endl;
+    for (const t_cycle_report& r : reports) {
+        double slots = (double) r.cycles * PES * r.cores;
+        double share = slots > 0.0 ? 1.0 / slots : 0.0;
+        double stalls = r.t_measured > 0.0 ? max(0.0, r.t_measured - r.t_predicted) / r.t_measured : 0.0;
+
+        out << r.name << "," << r.cores << "," << r.cycles << "," << r.t_predicted << "," << r.t_measured << "," << r.t_host << ","
+            << r.total.useful * share << "," << r.total.ragged * share << "," << r.total.pad_x * share << ","
+            << r.total.fifo * share << "," << r.total.pad_y * share << "," << r.total.overhead * share << ","
+            << r.imbalance * share << "," << stalls << endl;
+    }
+}
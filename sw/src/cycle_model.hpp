@@ -0,0 +1,68 @@
+#ifndef __CYCLE_MODEL_H
+#define __CYCLE_MODEL_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "defines.hpp"
+#include "batch.hpp"
+#include "PairHMMUserCore.h"
+
+// Fixed cycles of every batch on a core: loading the first PIPE_DEPTH read
+// bases and probabilities into the delay lines, and draining the last row
+// through the PE pipeline into the result sum
+#define CYCLES_BATCH_LOAD        PIPE_DEPTH
+#define CYCLES_BATCH_DRAIN       PES
+
+/**
+ * Cycles of one batch on a systolic array core, and how its PE-cycles (cycles
+ * times PES, one cell update each) are spent. The parts add up to
+ * cycles * PES.
+ *
+ * The array computes PASSES(Y) passes of PES haplotype columns. In every
+ * pass, px(X, Y) rows of all PIPE_DEPTH pairs of the batch stream through it,
+ * one pair per cycle.
+ */
+typedef struct struct_batch_cycles {
+    uint64_t cycles;
+    uint64_t useful;            // Cells of the pairs
+    uint64_t ragged;            // Pairs shorter than the longest of their batch
+    uint64_t pad_x;             // Reads padded to PES rows
+    uint64_t fifo;              // Extra row of the feedback FIFO, when there are several passes
+    uint64_t pad_y;             // Haplotypes padded to a multiple of PES columns
+    uint64_t overhead;          // CYCLES_BATCH_LOAD and CYCLES_BATCH_DRAIN
+} t_batch_cycles;
+
+/**
+ * Predicted time of a workload on one card, with the waste breakdown summed
+ * over its batches, and the measured times to compare with.
+ */
+typedef struct struct_cycle_report {
+    std::string name;
+    int cores;
+    uint64_t cycles;            // Of the core that finishes last
+    t_batch_cycles total;       // Summed over all batches of all cores
+    uint64_t imbalance;         // PE-cycles that cores wait for the last one
+    double t_predicted;         // cycles / FREQ_HW
+    double t_measured;          // Accelerator run time
+    double t_host;              // Table, column buffer and UserCore preparation
+} t_cycle_report;
+
+// Of the bitstream's array of PES PEs, or of an array of another number of PEs
+t_batch_cycles batch_cycles(t_workload *workload, int batch, int pes = PES);
+
+// Estimated cost of a batch in PE-cycles; divided by a throughput in CUPS, it is a time
+double batch_cost(t_workload *workload, int batch);
+
+// Batches of each of the slots of the UserCore registers, as the cores are
+// configured: balanced over the first cores slots, zero for the others
+std::vector<uint32_t> core_batch_lengths(int batches, int cores, int slots);
+
+t_cycle_report predict_cycles(t_workload *workload, int cores = CORES);
+
+// One line per report; waste as fractions of the PE-cycles of the slowest core, stalls of the measured time
+void print_cycle_reports(const std::vector<t_cycle_report>& reports, std::ostream& out);
+
+#endif //__CYCLE_MODEL_H
@@ -10,6 +10,10 @@ using namespace sw::unum;
 #define NBITS 32
 #define ES 2
 
+// Narrow formats of the reduced-precision host engines (posit<16, P16_ES> and posit<8, P8_ES>)
+#define P16_ES 1
+#define P8_ES 0
+
 #define DEBUG              1
 
 #ifndef DEBUG_PRECISION
@@ -39,14 +43,18 @@ using namespace sw::unum;
 #define ERR_LOWER                1.0f - ERROR_MARGIN
 #define ERR_UPPER                1.0f + ERROR_MARGIN
 
-// Debug printf macro
-#ifdef DEBUG
-#define DEBUG_PRINT(...)    do { fprintf(stderr, __VA_ARGS__); } while (0)
-#define BENCH_PRINT(...)    do { } while (0)
-#else
-#define DEBUG_PRINT(...)    do { } while (0)
-#define BENCH_PRINT(...)    do { fprintf(stderr, __VA_ARGS__); } while (0)
-#endif
+// Stream bases to the accelerator as 2-bit packed columns (with a separate
+// list of N positions) instead of 8-bit characters. The bitstream must be
+// built for the same layout.
+#ifndef PACKED_BASES
+#define PACKED_BASES             0
+#endif // PACKED_BASES
+
+// Burst step length in bytes; accelerator buffers are aligned to this
+#define BURST_LENGTH             4096
+
+// Value of a result word that the accelerator has not written yet
+#define RESULT_SENTINEL          0xDEADBEEF
 
 #define PROBABILITIES 8
 #define PROBS_BYTES (PROBABILITIES * 4)
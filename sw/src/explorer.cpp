@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <omp.h>
+
+#include "utils.hpp"
+#include "pairhmm_posit.hpp"
+#include "pairhmm_float.hpp"
+#include "pairhmm_small.hpp"
+#include "explorer.hpp"
+#include "accelerator.hpp"
+#include "cycle_model.hpp"
+#include "sampling.hpp"
+#include "log.hpp"
+
+// Results of one format in pair order, and its host time per length class
+typedef struct struct_format_run {
+    std::string format;
+    int width;                  // Bits of the datapath of a PE
+    std::vector<cpp_dec_float_100> values;
+    std::map<int, double> t_host;
+} t_format_run;
+
+template<class Engine>
+static t_format_run run_format(const std::string& format, int width, Engine& engine,
+                               std::vector<t_batch>& batches, t_workload *workload) {
+    LOG_INFO(LOG_MAIN, "Computing %s...\n", format.c_str());
+
+    t_format_run run;
+    run.format = format;
+    run.width = width;
+
+    for (int b = 0; b < workload->batches; b++) {
+        double start = omp_get_wtime();
+        engine.calculate_batch(batches[b], b);
+        run.t_host[length_class(workload, b)] += omp_get_wtime() - start;
+    }
+
+    for (const Entry& e : engine.debug_values.items) {
+        run.values.push_back(e.value);
+    }
+    return run;
+}
+
+// Mark the points from first on that no other one beats in both accuracy and this throughput
+static void mark_pareto(std::vector<t_format_point>& points, size_t first, double t_format_point::* throughput,
+                        bool t_format_point::* pareto) {
+    auto accuracy = [](const t_format_point& p) {
+        return std::isnan(p.da_median) ? -std::numeric_limits<double>::infinity() : p.da_median;
+    };
+    for (size_t i = first; i < points.size(); i++) {
+        points[i].*pareto = true;
+        for (size_t j = first; j < points.size(); j++) {
+            bool as_good = accuracy(points[j]) >= accuracy(points[i]) && points[j].*throughput >= points[i].*throughput;
+            bool better = accuracy(points[j]) > accuracy(points[i]) || points[j].*throughput > points[i].*throughput;
+            if (j != i && as_good && better) {
+                points[i].*pareto = false;
+            }
+        }
+    }
+}
+
+static std::string posit_name(int nbits, int es) {
+    return "posit" + std::to_string(nbits) + "_" + std::to_string(es);
+}
+
+std::vector<t_format_point> explore_formats(std::vector<t_batch>& batches, t_workload *workload) {
+    PairHMMFloat<cpp_dec_float_100> reference_engine(workload, false, false);
+    t_format_run reference = run_format("reference", 0, reference_engine, batches, workload);
+
+    // One engine at a time; only their results are kept
+    std::vector<t_format_run> runs;
+    {
+        PairHMMPosit engine(workload, false, false);
+        runs.push_back(run_format(posit_name(NBITS, ES), NBITS, engine, batches, workload));
+    }
+    {
+        PairHMMFloat<posit<NBITS, EXPLORE_ES> > engine(workload, false, false);
+        runs.push_back(run_format(posit_name(NBITS, EXPLORE_ES), NBITS, engine, batches, workload));
+    }
+    {
+        PairHMMFloat<float> engine(workload, false, false);
+        runs.push_back(run_format("float", 32, engine, batches, workload));
+    }
+    {
+        PairHMMFloat<double> engine(workload, false, false);
+        runs.push_back(run_format("double", 64, engine, batches, workload));
+    }
+    {
+        PairHMMSmallPosit<16, P16_ES> engine(workload);
+        runs.push_back(run_format(engine.name(), 16, engine, batches, workload));
+    }
+    {
+        PairHMMSmallPosit<8, P8_ES> engine(workload);
+        runs.push_back(run_format(engine.name(), 8, engine, batches, workload));
+    }
+
+    // Batches and cells of every length class
+    std::map<int, std::vector<int> > classes;
+    std::map<int, uint64_t> class_cells;
+    for (int b = 0; b < workload->batches; b++) {
+        int c = length_class(workload, b);
+        classes[c].push_back(b);
+        class_cells[c] += batch_cycles(workload, b).useful;
+    }
+
+    std::vector<t_format_point> points;
+    for (auto& entry : classes) {
+        int c = entry.first;
+        size_t first = points.size();
+
+        for (t_format_run& run : runs) {
+            t_format_point p;
+            p.format = run.format;
+            p.length_class = c;
+            p.pairs = entry.second.size() * PIPE_DEPTH;
+            p.cells = class_cells[c];
+            p.failures = 0;
+
+            std::vector<double> da;
+            for (int b : entry.second) {
+                for (int j = 0; j < PIPE_DEPTH; j++) {
+                    int k = b * PIPE_DEPTH + j;
+                    double d = decimal_accuracy(reference.values[k], run.values[k]).convert_to<double>();
+                    if (std::isnan(d) || d == -std::numeric_limits<double>::infinity()) {
+                        p.failures++;
+                    }
+                    if (!std::isnan(d)) {
+                        da.push_back(d);
+                    }
+                }
+            }
+            std::sort(da.begin(), da.end());
+            p.da_median = da.empty() ? std::numeric_limits<double>::quiet_NaN() : da[da.size() / 2];
+            p.da_min = da.empty() ? std::numeric_limits<double>::quiet_NaN() : da.front();
+
+            p.t_host = run.t_host[c];
+            p.mcups_host = p.t_host > 0.0 ? ((double) p.cells / p.t_host) / 1000000 : 0.0;
+
+            // The cores of a card work on different batches at the same time
+            p.pes = std::max(1, PES * NBITS / run.width);
+            uint64_t cycles = 0;
+            for (int b : entry.second) {
+                cycles += batch_cycles(workload, b, p.pes).cycles;
+            }
+            p.mcups_model = cycles > 0 ? ((double) p.cells * CORES * FREQ_HW / (double) cycles) / 1000000 : 0.0;
+            points.push_back(p);
+        }
+
+        mark_pareto(points, first, &t_format_point::mcups_host, &t_format_point::pareto_host);
+        mark_pareto(points, first, &t_format_point::mcups_model, &t_format_point::pareto_model);
+    }
+
+    return points;
+}
+
+void print_format_points(const std::vector<t_format_point>& points, std::ostream& out) {
+    out << "class,format,pairs,cells,da_median,da_min,failures,t_host,p_host,pes,p_model,pareto_host,pareto_model" << endl;
+    for (const t_format_point& p : points) {
+        out << p.length_class << "," << p.format << "," << p.pairs << "," << p.cells << ","
+            << p.da_median << "," << p.da_min << "," << p.failures << ","
+            << p.t_host << "," << p.mcups_host << "," << p.pes << "," << p.mcups_model << ","
+            << (p.pareto_host ? 1 : 0) << "," << (p.pareto_model ? 1 : 0) << endl;
+    }
+}
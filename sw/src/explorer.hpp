@@ -0,0 +1,53 @@
+#ifndef __EXPLORER_H
+#define __EXPLORER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "defines.hpp"
+#include "batch.hpp"
+
+// Exponent size of the other posit<32> bitstream (pe_posit_conf has ES 2 and 3)
+#define EXPLORE_ES               (ES == 3 ? 2 : 3)
+
+/**
+ * Accuracy and throughput of one number format on the batches of one length
+ * class. The decimal accuracy of a pair is that of its result to the
+ * 100-digit reference; infinite if they are equal.
+ */
+typedef struct struct_format_point {
+    std::string format;
+    int length_class;           // log2 of the cells of a pair, as for sampled validation
+    uint64_t pairs;
+    uint64_t cells;
+    double da_median;
+    double da_min;
+    uint64_t failures;          // Pairs whose result lost its sign, or became zero or infinite
+    double t_host;              // Time of the host engine
+    double mcups_host;
+    int pes;                    // PEs of an array of this datapath width in the area of PES posit<NBITS> PEs
+    double mcups_model;         // Of one card with arrays of pes PEs, from the cycle model
+    bool pareto_host;           // No other format of the class is at least as accurate and as fast on the host
+    bool pareto_model;          // Same, at the modelled card throughput
+} t_format_point;
+
+/**
+ * Compute the workload with every supported number format in this process:
+ * posit<32, ES> (bit-identical to the accelerator), posit<32, EXPLORE_ES>,
+ * float, double, and the narrow posit<16, P16_ES> and posit<8, P8_ES>.
+ *
+ * Pareto optimality is marked twice, each on one basis for all formats: the
+ * measured host throughput, and the throughput the cycle model predicts for
+ * one card. The model assumes that the number of PEs scales inversely with
+ * the datapath width at the same clock, e.g. 2 * PES posit<16> PEs or
+ * PES / 2 double PEs in place of PES posit<32> PEs. Only posit<32, 2> and
+ * posit<32, 3> have a bitstream; the others are estimates.
+ */
+std::vector<t_format_point> explore_formats(std::vector<t_batch>& batches, t_workload *workload);
+
+// One line per format and length class, by class
+void print_format_points(const std::vector<t_format_point>& points, std::ostream& out);
+
+#endif //__EXPLORER_H
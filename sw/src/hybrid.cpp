@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <omp.h>
+
+#include "hybrid.hpp"
+#include "utils.hpp"
+#include "cycle_model.hpp"
+
+HybridExecutor::HybridExecutor(int cpu_threads, int cpu_kernel)
+        : cpu_threads(cpu_threads), cpu_kernel(cpu_kernel) {
+}
+
+void HybridExecutor::add(std::shared_ptr<Accelerator> accelerator) {
+    accelerators.push_back(accelerator);
+}
+
+// Read profiles of one CPU thread, carried from batch to batch so batches of the same read reuse them
+typedef struct struct_cpu_profiles {
+    ReadProfile<posit<NBITS, ES>> posit_profile;
+    ReadProfile<float> float_profile;
+} t_cpu_profiles;
+
+// Compute batch b of the workload, selected[b] of the batches, on the CPU, writing its results into place
+static void cpu_batch(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload, int b, int kernel,
+                      t_cpu_profiles& profiles, uint32_t *results) {
+    t_workload *one = select_workload(workload, std::vector<int>(1, b));
+    std::vector<uint32_t> bits;
+
+    if (kernel == CPU_KERNEL_FLOAT) {
+        PairHMMFloat<float> engine(one, false, false);
+        std::swap(engine.profile, profiles.float_profile);
+        engine.calculate_batch(batches[selection[b]], 0);
+        std::swap(engine.profile, profiles.float_profile);
+        bits = engine.result_bits();
+    } else {
+        PairHMMPosit engine(one, false, false);
+        std::swap(engine.profile, profiles.posit_profile);
+        engine.calculate_batch(batches[selection[b]], 0);
+        std::swap(engine.profile, profiles.posit_profile);
+        bits = engine.result_bits();
+    }
+
+    std::copy(bits.begin(), bits.end(), results + b * PIPE_DEPTH);
+    free_workload(one);
+}
+
+std::vector<uint32_t> HybridExecutor::run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload) {
+    std::vector<uint32_t> results(workload->batches * PIPE_DEPTH);
+
+    std::deque<int> queue;
+    double remaining = 0.0;
+    for (int b = 0; b < workload->batches; b++) {
+        queue.push_back(b);
+        remaining += batch_cost(workload, b);
+    }
+
+    // The watchdog counters of the cards are lifetime totals; report only this run's
+    int timeouts_before = 0, fallback_before = 0;
+    for (std::shared_ptr<Accelerator>& acc : accelerators) {
+        timeouts_before += acc->timeouts;
+        fallback_before += acc->fallback_batches;
+    }
+
+    std::mutex lock;
+    double start = omp_get_wtime();
+
+    // Work finished and busy time of each side. The queue is balanced in PE-cycles of
+    // the cycle model, cell updates are only counted for the report.
+    std::vector<double> accel_cells(accelerators.size(), 0.0), accel_cost(accelerators.size(), 0.0);
+    std::vector<double> accel_time(accelerators.size(), 0.0);
+    double cpu_cells = 0.0, cpu_cost = 0.0;
+    int batches_accel = 0, batches_cpu = 0, chunks_accel = 0;
+
+    // Measured CPU throughput so far; zero until the first batch finished
+    auto cpu_throughput = [&]() {
+        double elapsed = omp_get_wtime() - start;
+        return (cpu_threads > 0 && elapsed > 0.0) ? cpu_cost / elapsed : 0.0;
+    };
+
+    std::vector<std::thread> threads;
+
+    for (size_t a = 0; a < accelerators.size(); a++) {
+        threads.push_back(std::thread([&, a]() {
+            Accelerator& acc = *accelerators[a];
+            while (true) {
+                std::vector<int> chunk;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (queue.empty()) {
+                        break;
+                    }
+
+                    // Expected throughput of all accelerators and of the CPU threads. Until
+                    // the CPU threads finished a batch, assume they keep up with this accelerator.
+                    double mine = accel_time[a] > 0.0 ? accel_cost[a] / accel_time[a] : acc.throughput();
+                    double all = cpu_cost > 0.0 ? cpu_throughput() : (cpu_threads > 0 ? mine : 0.0);
+                    for (size_t o = 0; o < accelerators.size(); o++) {
+                        all += accel_time[o] > 0.0 ? accel_cost[o] / accel_time[o] : accelerators[o]->throughput();
+                    }
+
+                    // Take half of this accelerator's share of what is left, so that later
+                    // chunks can still correct for a wrong estimate
+                    double share = (cpu_threads > 0 ? 0.5 : 1.0) * remaining * mine / all;
+                    double taken = 0.0;
+                    do {
+                        int b = queue.front();
+                        queue.pop_front();
+                        chunk.push_back(b);
+                        taken += batch_cost(workload, b);
+                    } while (!queue.empty() && taken + batch_cost(workload, queue.front()) <= share);
+                    remaining -= taken;
+                }
+
+                // The accelerator reads the batches of the chunk in place
+                t_workload *sub = select_workload(workload, chunk);
+                std::vector<int> chunk_selection;
+                for (int b : chunk) {
+                    chunk_selection.push_back(selection[b]);
+                }
+
+                double t0 = omp_get_wtime();
+                std::vector<uint32_t> bits = acc.run(batches, chunk_selection, sub);
+                double t1 = omp_get_wtime();
+
+                for (size_t i = 0; i < chunk.size(); i++) {
+                    std::copy(bits.begin() + i * PIPE_DEPTH, bits.begin() + (i + 1) * PIPE_DEPTH,
+                              results.begin() + chunk[i] * PIPE_DEPTH);
+                }
+
+                std::lock_guard<std::mutex> guard(lock);
+                for (int b : chunk) {
+                    accel_cost[a] += batch_cost(workload, b);
+                }
+                accel_cells[a] += sub->cups;
+                accel_time[a] += t1 - t0;
+                batches_accel += chunk.size();
+                chunks_accel++;
+                free_workload(sub);
+            }
+        }));
+    }
+
+    for (int t = 0; t < cpu_threads; t++) {
+        threads.push_back(std::thread([&]() {
+            t_cpu_profiles profiles;
+            while (true) {
+                int b;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (queue.empty()) {
+                        break;
+                    }
+                    b = queue.back();
+                    queue.pop_back();
+                    remaining -= batch_cost(workload, b);
+                }
+
+                cpu_batch(batches, selection, workload, b, cpu_kernel, profiles, results.data());
+
+                std::lock_guard<std::mutex> guard(lock);
+                cpu_cost += batch_cost(workload, b);
+                for (int p = 0; p < PIPE_DEPTH; p++) {
+                    cpu_cells += (double) workload->read[b * PIPE_DEPTH + p] * (double) workload->hapl[b * PIPE_DEPTH + p];
+                }
+                batches_cpu++;
+            }
+        }));
+    }
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    report.t_total = omp_get_wtime() - start;
+    report.batches_accel = batches_accel;
+    report.batches_cpu = batches_cpu;
+    report.chunks_accel = chunks_accel;
+    report.cups_accel = 0.0;
+    for (size_t a = 0; a < accelerators.size(); a++) {
+        report.cups_accel += accel_time[a] > 0.0 ? accel_cells[a] / accel_time[a] : 0.0;
+    }
+    report.cups_cpu = report.t_total > 0.0 ? cpu_cells / report.t_total : 0.0;
+    report.cups = workload->cups;
+    report.timeouts = 0;
+    report.fallback_batches = 0;
+    for (std::shared_ptr<Accelerator>& acc : accelerators) {
+        report.timeouts += acc->timeouts;
+        report.fallback_batches += acc->fallback_batches;
+    }
+    report.timeouts -= timeouts_before;
+    report.fallback_batches -= fallback_before;
+
+    return results;
+}
+
+void add_hybrid_report(t_hybrid_report& total, const t_hybrid_report& run) {
+    total.batches_accel += run.batches_accel;
+    total.batches_cpu += run.batches_cpu;
+    total.chunks_accel += run.chunks_accel;
+    total.cups_accel = run.cups_accel;
+    total.cups_cpu = run.cups_cpu;
+    total.cups += run.cups;
+    total.timeouts += run.timeouts;
+    total.fallback_batches += run.fallback_batches;
+    total.t_total += run.t_total;
+}
+
+void print_hybrid_report(const t_hybrid_report& report, std::ostream& out) {
+    out << "batches_accel,batches_cpu,chunks_accel,p_accel,p_cpu,t_hybrid,p_hybrid,timeouts,fallback_batches" << endl;
+    out << report.batches_accel << "," << report.batches_cpu << "," << report.chunks_accel << ","
+        << report.cups_accel / 1000000 << "," << report.cups_cpu / 1000000 << "," << report.t_total << ","
+        << (report.t_total > 0 ? ((double) report.cups / report.t_total) / 1000000 : 0) << "," << report.timeouts << "," << report.fallback_batches << endl;
+}
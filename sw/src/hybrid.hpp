@@ -0,0 +1,61 @@
+#ifndef __HYBRID_H
+#define __HYBRID_H
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <iostream>
+
+#include "batch.hpp"
+#include "accelerator.hpp"
+
+// Kernel used by the CPU side of the hybrid executor
+#define CPU_KERNEL_POSIT         0      // Bit-identical to the accelerator
+#define CPU_KERNEL_FLOAT         1      // Faster, results rounded to posit afterwards
+
+typedef struct struct_hybrid_report {
+    int batches_accel;
+    int batches_cpu;
+    int chunks_accel;
+    double cups_accel;          // Measured throughput of the accelerators together (CUPS)
+    double cups_cpu;            // Measured throughput of the CPU threads together (CUPS)
+    uint64_t cups;              // Cell updates of the whole workload
+    int timeouts;               // Accelerator runs that missed their deadline
+    int fallback_batches;       // Batches of those runs that were computed on the host
+    double t_total;
+} t_hybrid_report;
+
+/**
+ * Computes a workload on the accelerators and on a pool of CPU threads at the
+ * same time. All batches are in one shared deque: accelerators take chunks
+ * from the front, CPU threads take single batches from the back. The chunk an
+ * accelerator takes is its share of the remaining work according to the
+ * throughput measured so far, so both sides run out of work at about the
+ * same time.
+ */
+class HybridExecutor {
+public:
+    HybridExecutor(int cpu_threads, int cpu_kernel = CPU_KERNEL_POSIT);
+
+    void add(std::shared_ptr<Accelerator> accelerator);
+
+    /**
+     * Compute the batches selected by index; workload is that of the selection.
+     * Raw posit results in the order of the selection (i * PIPE_DEPTH + pair).
+     */
+    std::vector<uint32_t> run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload);
+
+    t_hybrid_report report;
+
+private:
+    int cpu_threads;
+    int cpu_kernel;
+    std::vector<std::shared_ptr<Accelerator> > accelerators;
+};
+
+// Add the counts and times of another run; the throughputs become those of that run
+void add_hybrid_report(t_hybrid_report& total, const t_hybrid_report& run);
+
+void print_hybrid_report(const t_hybrid_report& report, std::ostream& out);
+
+#endif //__HYBRID_H
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log.hpp"
+
+static const char *module_names[LOG_MODULES] = {"main", "bench", "workload", "batch", "accel", "sched", "memory", "verify"};
+static const char *level_names[] = {"error", "warn", "info", "debug", "trace"};
+
+/**
+ * Writes the queued messages to stderr on its own thread, so the threads that
+ * log only format into memory. Every wake-up writes everything that was
+ * queued since the last one and flushes once.
+ */
+class LogSink {
+public:
+    LogSink() : written(0), queued(0), stopping(false), worker(&LogSink::drain, this) {
+    }
+
+    ~LogSink() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        worker.join();
+    }
+
+    void push(std::string message) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(message));
+            queued++;
+        }
+        ready.notify_one();
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        uint64_t target = queued;
+        done.wait(lock, [&] { return written >= target; });
+    }
+
+private:
+    void drain() {
+        std::vector<std::string> messages;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            ready.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                break;
+            }
+            messages.swap(queue);
+            lock.unlock();
+
+            for (const std::string& m : messages) {
+                fwrite(m.data(), 1, m.size(), stderr);
+            }
+            fflush(stderr);
+
+            lock.lock();
+            written += messages.size();
+            messages.clear();
+            done.notify_all();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable done;
+    std::vector<std::string> queue;
+    uint64_t written;
+    uint64_t queued;
+    bool stopping;
+    std::thread worker;
+};
+
+static LogSink& sink() {
+    static LogSink s;
+    return s;
+}
+
+static int find_name(const char *const *names, int n, const std::string& name) {
+    for (int i = 0; i < n; i++) {
+        if (name == names[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool configure(std::atomic<int> *levels, const char *filter) {
+    std::string spec(filter);
+    bool ok = true;
+
+    size_t begin = 0;
+    while (begin <= spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string item = spec.substr(begin, end - begin);
+        begin = end + 1;
+        if (item.empty()) {
+            continue;
+        }
+
+        // "<level>" applies to all modules
+        size_t eq = item.find('=');
+        int level = find_name(level_names, LOG_LEVEL_TRACE + 1, eq == std::string::npos ? item : item.substr(eq + 1));
+        int module = eq == std::string::npos ? LOG_MODULES : find_name(module_names, LOG_MODULES, item.substr(0, eq));
+        if (level < 0 || module < 0) {
+            ok = false;
+            continue;
+        }
+
+        for (int m = 0; m < LOG_MODULES; m++) {
+            if (module == LOG_MODULES || module == m) {
+                levels[m].store(level, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    return ok;
+}
+
+// Level of each module; set from LOG_ENV on first use
+static std::atomic<int> *module_levels() {
+    static std::atomic<int> levels[LOG_MODULES];
+    static bool initialized = [] {
+#ifdef DEBUG
+        int initial = LOG_LEVEL_DEBUG;
+#else
+        int initial = LOG_LEVEL_INFO;
+#endif
+        for (int m = 0; m < LOG_MODULES; m++) {
+            levels[m].store(initial, std::memory_order_relaxed);
+        }
+
+        const char *filter = getenv(LOG_ENV);
+        if (filter != NULL && !configure(levels, filter)) {
+            fprintf(stderr, "WARNING: could not parse %s=%s\n", LOG_ENV, filter);
+        }
+        return true;
+    }();
+    (void) initialized;
+    return levels;
+}
+
+bool log_enabled(t_log_level level, t_log_module module) {
+    return level <= module_levels()[module].load(std::memory_order_relaxed);
+}
+
+void log_write(t_log_level level, t_log_module module, const char *format, ...) {
+    (void) level;
+    (void) module;
+
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) {
+        return;
+    }
+
+    std::string message;
+    if ((size_t) length < sizeof(buffer)) {
+        message.assign(buffer, length);
+    } else {
+        message.resize(length + 1);
+        va_start(args, format);
+        vsnprintf(&message[0], message.size(), format, args);
+        va_end(args);
+        message.resize(length);
+    }
+    sink().push(std::move(message));
+}
+
+void log_flush() {
+    sink().flush();
+}
@@ -0,0 +1,57 @@
+#ifndef __LOG_H
+#define __LOG_H
+
+#include "defines.hpp"
+
+typedef enum enum_log_level {
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_WARN = 1,
+    LOG_LEVEL_INFO = 2,
+    LOG_LEVEL_DEBUG = 3,
+    LOG_LEVEL_TRACE = 4         // Per batch or per result; only for small runs
+} t_log_level;
+
+typedef enum enum_log_module {
+    LOG_MAIN = 0,
+    LOG_BENCH,                  // Benchmark line with the size of the run
+    LOG_WORKLOAD,
+    LOG_BATCH,
+    LOG_ACCEL,
+    LOG_SCHED,
+    LOG_MEMORY,
+    LOG_VERIFY,
+    LOG_MODULES
+} t_log_module;
+
+// Highest level that is compiled in; messages above it and their arguments
+// are removed by the compiler
+#ifndef LOG_LEVEL_MAX
+#ifdef DEBUG
+#define LOG_LEVEL_MAX            LOG_LEVEL_TRACE
+#else
+#define LOG_LEVEL_MAX            LOG_LEVEL_INFO
+#endif
+#endif // LOG_LEVEL_MAX
+
+// Run-time filter: "<level>" for all modules, "<module>=<level>" for one, comma
+// separated, e.g. PAIRHMM_LOG=info,accel=trace
+#define LOG_ENV                  "PAIRHMM_LOG"
+
+bool log_enabled(t_log_level level, t_log_module module);
+
+// Format the message and queue it for the sink thread, which writes it to stderr
+void log_write(t_log_level level, t_log_module module, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+// Wait until all queued messages are written
+void log_flush();
+
+#define LOG(level, module, ...) \
+    do { if ((level) <= LOG_LEVEL_MAX && log_enabled(level, module)) log_write(level, module, __VA_ARGS__); } while (0)
+
+#define LOG_ERROR(module, ...)   LOG(LOG_LEVEL_ERROR, module, __VA_ARGS__)
+#define LOG_WARN(module, ...)    LOG(LOG_LEVEL_WARN, module, __VA_ARGS__)
+#define LOG_INFO(module, ...)    LOG(LOG_LEVEL_INFO, module, __VA_ARGS__)
+#define LOG_DEBUG(module, ...)   LOG(LOG_LEVEL_DEBUG, module, __VA_ARGS__)
+#define LOG_TRACE(module, ...)   LOG(LOG_LEVEL_TRACE, module, __VA_ARGS__)
+
+#endif //__LOG_H
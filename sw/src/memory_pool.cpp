@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <string>
+#include <algorithm>
+
+#include "memory_pool.hpp"
+
+// From <numaif.h>, which is not installed everywhere
+#define POOL_MPOL_BIND           2
+#define POOL_MPOL_MF_MOVE        (1 << 1)
+
+AcceleratorMemoryPool::AcceleratorMemoryPool(size_t alignment, bool huge_pages, int numa_node)
+        : align(alignment), huge(huge_pages), node(numa_node),
+          allocated(0), peak(0), allocations(0), huge_allocations(0), bind_failures(0) {
+    // posix_memalign requires a power of two that is a multiple of sizeof(void *)
+    if (align < sizeof(void *) || (align & (align - 1)) != 0) {
+        fprintf(stderr, "ERROR: memory pool alignment %zu is not a power of two\n", align);
+        exit(EXIT_FAILURE);
+    }
+}
+
+bool AcceleratorMemoryPool::bind(void *buffer, size_t size) {
+    // mbind works on whole pages; a buffer that does not start on a page
+    // boundary shares its first page with other allocations
+    size_t page = sysconf(_SC_PAGESIZE);
+    if ((uintptr_t) buffer % page != 0) {
+        return false;
+    }
+
+    unsigned long mask[4] = {0};
+    size_t max_node = sizeof(mask) * 8;
+    if (node >= (int) max_node) {
+        return false;
+    }
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+
+    return syscall(SYS_mbind, buffer, size, POOL_MPOL_BIND, mask, max_node, POOL_MPOL_MF_MOVE) == 0;
+}
+
+arrow::Status AcceleratorMemoryPool::Allocate(int64_t size, uint8_t **out) {
+    if (size < 0) {
+        return arrow::Status::Invalid("negative allocation size");
+    }
+
+    // Large buffers start on a huge page boundary so they can be fully backed by huge pages
+    bool large = huge && size >= HUGE_PAGE_SIZE;
+    size_t alignment = large ? max(align, (size_t) HUGE_PAGE_SIZE) : align;
+
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, alignment, size > 0 ? size : 1) != 0) {
+        return arrow::Status::OutOfMemory("accelerator memory pool: failed to allocate " + std::to_string(size) + " bytes");
+    }
+
+    if (large) {
+        madvise(buffer, size, MADV_HUGEPAGE);
+        huge_allocations++;
+    }
+
+    if (node != NUMA_NODE_ANY && size > 0 && !bind(buffer, size)) {
+        bind_failures++;
+    }
+
+    *out = (uint8_t *) buffer;
+
+    int64_t now = (allocated += size);
+    int64_t prev = peak.load();
+    while (now > prev && !peak.compare_exchange_weak(prev, now));
+    allocations++;
+
+    return arrow::Status::OK();
+}
+
+arrow::Status AcceleratorMemoryPool::Reallocate(int64_t old_size, int64_t new_size, uint8_t **ptr) {
+    // Always move, so the new buffer gets the alignment, huge page advice and binding of its size
+    uint8_t *buffer;
+    arrow::Status status = Allocate(new_size, &buffer);
+    if (!status.ok()) {
+        return status;
+    }
+
+    memcpy(buffer, *ptr, min(old_size, new_size));
+    Free(*ptr, old_size);
+    *ptr = buffer;
+
+    return arrow::Status::OK();
+}
+
+void AcceleratorMemoryPool::Free(uint8_t *buffer, int64_t size) {
+    free(buffer);
+    allocated -= size;
+}
+
+int64_t AcceleratorMemoryPool::bytes_allocated() const {
+    return allocated.load();
+}
+
+int64_t AcceleratorMemoryPool::max_memory() const {
+    return peak.load();
+}
+
+t_pool_stats AcceleratorMemoryPool::stats() const {
+    t_pool_stats s;
+    s.bytes_allocated = allocated.load();
+    s.max_memory = peak.load();
+    s.allocations = allocations.load();
+    s.huge_allocations = huge_allocations.load();
+    s.bind_failures = bind_failures.load();
+    return s;
+}
+
+static bool array_aligned(const std::shared_ptr<arrow::ArrayData>& data, size_t alignment) {
+    for (const std::shared_ptr<arrow::Buffer>& buffer : data->buffers) {
+        if (buffer && (uintptr_t) buffer->data() % alignment != 0) {
+            return false;
+        }
+    }
+    for (const std::shared_ptr<arrow::ArrayData>& child : data->child_data) {
+        if (!array_aligned(child, alignment)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool column_aligned(const std::shared_ptr<arrow::Column>& column, size_t alignment) {
+    for (const std::shared_ptr<arrow::Array>& chunk : column->data()->chunks()) {
+        if (!array_aligned(chunk->data(), alignment)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef __MEMORY_POOL_H
+#define __MEMORY_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+// Apache Arrow
+#include <arrow/api.h>
+
+#include "defines.hpp"
+#include "result_arena.hpp"
+
+// No NUMA binding
+#define NUMA_NODE_ANY            -1
+
+typedef struct struct_pool_stats {
+    int64_t bytes_allocated;
+    int64_t max_memory;
+    uint64_t allocations;
+    uint64_t huge_allocations;  // Allocations of at least HUGE_PAGE_SIZE, aligned to and advised as huge pages
+    uint64_t bind_failures;     // Allocations that could not be bound to the NUMA node
+} t_pool_stats;
+
+/**
+ * Memory pool for the columns that are streamed to the accelerator. Every
+ * buffer is aligned to (at least) the burst length, so Fletcher can hand the
+ * buffers to the card as they are. Large buffers are backed by transparent
+ * huge pages and, if a node is given, bound to the NUMA node of the card.
+ */
+class AcceleratorMemoryPool : public arrow::MemoryPool {
+public:
+    AcceleratorMemoryPool(size_t alignment = BURST_LENGTH, bool huge_pages = true, int numa_node = NUMA_NODE_ANY);
+
+    arrow::Status Allocate(int64_t size, uint8_t **out) override;
+    arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t **ptr) override;
+    void Free(uint8_t *buffer, int64_t size) override;
+
+    int64_t bytes_allocated() const override;
+    int64_t max_memory() const override;
+
+    t_pool_stats stats() const;
+
+    size_t alignment() const { return align; }
+
+private:
+    size_t align;
+    bool huge;
+    int node;
+
+    std::atomic<int64_t> allocated;
+    std::atomic<int64_t> peak;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> huge_allocations;
+    std::atomic<uint64_t> bind_failures;
+
+    bool bind(void *buffer, size_t size);
+};
+
+// Check that every buffer of a column (including the child arrays) is aligned
+bool column_aligned(const std::shared_ptr<arrow::Column>& column, size_t alignment);
+
+#endif //__MEMORY_POOL_H
@@ -29,35 +29,48 @@
 #include <fletcher/fletcher.h>
 
 // Pair-HMM FPGA UserCore
-#include "scheme.hpp"
 #include "PairHMMUserCore.h"
 #include "pairhmm.hpp"
 
 #include "debug_values.hpp"
 #include "utils.hpp"
 #include "batch.hpp"
+#include "verify.hpp"
+#include "posit_decode.hpp"
+#include "pairhmm_small.hpp"
+#include "small_posit.hpp"
+#include "sampling.hpp"
+#include "tiling.hpp"
+#include "accelerator.hpp"
+#include "scheduler.hpp"
+#include "cycle_model.hpp"
+#include "result_store.hpp"
+#include "hybrid.hpp"
+#include "stream.hpp"
+#include "log.hpp"
+#include "checkpoint.hpp"
+#include "explorer.hpp"
 
 #ifndef PLATFORM
   #define PLATFORM 2
 #endif
 
-/* Burst step length in bytes */
-#define BURST_LENGTH 4096
-
 using namespace std;
 
-/* Structure to easily convert from 64-bit addresses to 2x32-bit registers */
-typedef struct _lohi {
-        uint32_t lo;
-        uint32_t hi;
-}
-lohi;
-
-typedef union _addr_lohi {
-        uint64_t full;
-        lohi half;
+/**
+ * Create the cards and emulated cards to compute on
+ */
+static std::vector<shared_ptr<Accelerator> > create_accelerators(int cards, int emulated, int numa_node, double deadline)
+{
+        std::vector<shared_ptr<Accelerator> > accelerators;
+        for (int c = 0; c < cards; c++) {
+                accelerators.push_back(make_shared<SNAPAccelerator>(c, numa_node, deadline));
+        }
+        for (int e = 0; e < emulated; e++) {
+                accelerators.push_back(make_shared<EmulatedAccelerator>(e));
+        }
+        return accelerators;
 }
-addr_lohi;
 
 /**
  * Main function for pair HMM accelerator
@@ -66,67 +79,325 @@ int main(int argc, char ** argv)
 {
         // Times
         double start, stop;
-        double t_fill_batch, t_fill_table, t_prepare_column, t_create_core, t_fpga, t_sw, t_float, t_dec = 0.0;
+        double t_fill_batch, t_fill_table, t_prepare_column, t_create_core, t_fpga;
+        double t_sw = 0.0, t_float = 0.0, t_dec = 0.0;
+
+        // Time of the tiled host engine, which computes instead of the cards when Y > MAX_BP_STRING
+        double t_tiled = 0.0;
 
-        srand(0);
         flush(cout);
 
         t_workload *workload;
         std::vector<t_batch> batches;
 
-        int rc = 0;
-
-        float f_hw = 125e6;
-        float max_cups = f_hw * (float)16;
+        // Peak throughput of one card
+        float max_cups = MAX_CUPS_HW;
 
         unsigned long pairs, x, y = 0;
         int initial_constant_power = 1;
         bool calculate_sw = true;
+
+        // Sampled validation: fraction of the batches to validate, and CPU seconds
+        // per accelerator second it may use (0 = no limit). By default all batches
+        // are validated before the accelerator runs.
+        double sample_fraction = 1.0;
+        double cpu_budget = 0.0;
         bool show_results = false;
         bool show_table = false;
 
-        DEBUG_PRINT("Parsing input arguments...\n");
-        if (argc > 4) {
-                pairs = strtoul(argv[1], NULL, 0);
-                x = strtoul(argv[2], NULL, 0);
-                y = strtoul(argv[3], NULL, 0);
-                initial_constant_power = strtoul(argv[4], NULL, 0);
-
-                workload = gen_workload(pairs, x, y);
+        // Banded host computation (0 = full matrix)
+        int band_width = 0;
+        int band_offset = 0;
+
+        // NUMA node of the cards, for the column buffers
+        int numa_node = NUMA_NODE_ANY;
+
+        // Number of cards, and of emulated cards computed on the host
+        int cards = 1;
+        int emulated = 0;
+
+        // CPU threads that compute batches next to the cards (0 = cards only)
+        int cpu_threads = 0;
+        int cpu_kernel = CPU_KERNEL_POSIT;
+
+        // Watchdog deadline of a card job in seconds (0 = derived from the job size)
+        double deadline = 0.0;
+
+        // Streaming mode: batches per window (0 = whole input at once) and windows generated ahead
+        int stream_window = 0;
+        int queue_depth = STREAM_QUEUE_DEPTH;
+
+        // Read-major batches: consecutive batches that are aligned against the same read
+        int haplotypes_per_read = 1;
+
+        // Substituted bases per candidate haplotype of a read (0 = independent haplotypes),
+        // and sharing of common haplotype prefixes in the posit host engine
+        int hapl_variants = 0;
+        bool prefix_sharing = false;
+
+        // Also compute with the narrow posit<16, P16_ES> and posit<8, P8_ES> host engines
+        bool small_posits = false;
+        double t_p16 = 0.0, t_p8 = 0.0;
+
+        // Arrow IPC file to export the results of all engines to (empty = none)
+        std::string results_file;
+
+        // File of completed batch results to resume from and append to (empty = none),
+        // and batches per accelerator run when checkpointing
+        std::string checkpoint_file;
+        int checkpoint_interval = CHECKPOINT_INTERVAL;
+
+        // Only compare the accuracy and throughput of all number formats on the workload
+        bool explore = false;
+
+        LOG_DEBUG(LOG_MAIN, "Parsing input arguments...\n");
+        int opt;
+        while ((opt = getopt(argc, argv, "b:a:n:c:e:t:fs:q:w:r:v:pm:u:lo:k:i:x")) != -1) {
+                switch (opt) {
+                case 'b':
+                        band_width = strtol(optarg, NULL, 0);
+                        break;
+                case 'a':
+                        band_offset = strtol(optarg, NULL, 0);
+                        break;
+                case 'n':
+                        numa_node = strtol(optarg, NULL, 0);
+                        break;
+                case 'c':
+                        cards = strtol(optarg, NULL, 0);
+                        break;
+                case 'e':
+                        emulated = strtol(optarg, NULL, 0);
+                        break;
+                case 't':
+                        cpu_threads = strtol(optarg, NULL, 0);
+                        break;
+                case 'f':
+                        cpu_kernel = CPU_KERNEL_FLOAT;
+                        break;
+                case 's':
+                        stream_window = strtol(optarg, NULL, 0);
+                        break;
+                case 'q':
+                        queue_depth = strtol(optarg, NULL, 0);
+                        break;
+                case 'w':
+                        deadline = strtod(optarg, NULL);
+                        break;
+                case 'r':
+                        haplotypes_per_read = strtol(optarg, NULL, 0);
+                        break;
+                case 'v':
+                        hapl_variants = strtol(optarg, NULL, 0);
+                        break;
+                case 'p':
+                        prefix_sharing = true;
+                        break;
+                case 'm':
+                        sample_fraction = strtod(optarg, NULL);
+                        break;
+                case 'u':
+                        cpu_budget = strtod(optarg, NULL);
+                        break;
+                case 'l':
+                        small_posits = true;
+                        break;
+                case 'o':
+                        results_file = optarg;
+                        break;
+                case 'k':
+                        checkpoint_file = optarg;
+                        break;
+                case 'i':
+                        checkpoint_interval = strtol(optarg, NULL, 0);
+                        break;
+                case 'x':
+                        explore = true;
+                        break;
+                default:
+                        argc = 0; // Print usage
+                }
+        }
 
-                BENCH_PRINT("M, ");
-                BENCH_PRINT("%8d, %8d, %8d, ", workload->pairs, x, y);
+        if (argc - optind > 3 && cards >= 0 && emulated >= 0 && cpu_threads >= 0 && cards + emulated + cpu_threads > 0
+            && stream_window >= 0 && queue_depth > 0 && deadline >= 0.0 && haplotypes_per_read > 0
+            && hapl_variants >= 0 && !(prefix_sharing && band_width > 0)
+            && sample_fraction >= 0.0 && sample_fraction <= 1.0 && cpu_budget >= 0.0
+            && checkpoint_interval > 0 && (checkpoint_file.empty() || stream_window == 0)
+            && !(explore && stream_window > 0)
+            && !(stream_window > 0 && (!results_file.empty() || band_width > 0 || prefix_sharing || small_posits))) {
+                pairs = strtoul(argv[optind], NULL, 0);
+                x = strtoul(argv[optind + 1], NULL, 0);
+                y = strtoul(argv[optind + 2], NULL, 0);
+                initial_constant_power = strtoul(argv[optind + 3], NULL, 0);
+
+                LOG_INFO(LOG_BENCH, "M, ");
+                LOG_INFO(LOG_BENCH, "%8lu, %8lu, %8lu, ", pairs, x, y);
         } else {
                 fprintf(stderr,
-                        "ERROR: Correct usage is: %s <pairs> <X> <Y> <initial constant power>\n",
+                        "ERROR: Correct usage is: %s [-b <band width>] [-a <alignment start>] [-n <NUMA node>] [-c <cards>] [-e <emulated cards>] [-w <deadline>] [-r <haplotypes per read> [-v <variants>] [-p]] [-m <sample fraction> [-u <CPU budget>]] [-l] [-o <results file>] [-k <checkpoint file> [-i <interval batches>]] [-x] [-t <CPU threads> [-f]] [-s <window batches> [-q <queue depth>]] <pairs> <X> <Y> <initial constant power>\n",
                         "pairhmm");
                 return (EXIT_FAILURE);
         }
 
+        // Validate a sample after the run instead of everything before it
+        bool sampled = sample_fraction > 0.0 && (sample_fraction < 1.0 || cpu_budget > 0.0);
+        calculate_sw = sample_fraction >= 1.0 && cpu_budget == 0.0;
+        SampledValidator validator(sample_fraction, cpu_budget);
+
+        if (stream_window > 0) {
+                // Generate, compute and release the input window by window, so memory use
+                // does not grow with the number of pairs
+                if (pairs % PIPE_DEPTH != 0) {
+                        printf("Number of pairs must be an integer multiple of %d.\n", PIPE_DEPTH);
+                        return (EXIT_FAILURE);
+                }
+
+                std::vector<shared_ptr<Accelerator> > accelerators = create_accelerators(cards, emulated, numa_node, deadline);
+                t_batch_executor executor;
+                if (y > MAX_BP_STRING) {
+                        executor = [](std::vector<t_batch>& b, const std::vector<int>& s, t_workload *w) {
+                                HostTileExecutor tiles;
+                                return calculate_tiled(b, s, w, tiles);
+                        };
+                } else if (cpu_threads > 0) {
+                        shared_ptr<HybridExecutor> hybrid = make_shared<HybridExecutor>(cpu_threads, cpu_kernel);
+                        for (shared_ptr<Accelerator>& acc : accelerators) {
+                                hybrid->add(acc);
+                        }
+                        executor = [hybrid](std::vector<t_batch>& b, const std::vector<int>& s, t_workload *w) { return hybrid->run(b, s, w); };
+                } else {
+                        shared_ptr<ShardScheduler> scheduler = make_shared<ShardScheduler>();
+                        for (shared_ptr<Accelerator>& acc : accelerators) {
+                                scheduler->add(acc);
+                        }
+                        executor = [scheduler](std::vector<t_batch>& b, const std::vector<int>& s, t_workload *w) { return scheduler->run(b, s, w); };
+                }
+
+                t_verify_summary summary;
+                t_stream_report report = run_stream(pairs, x, y, powf(2.0, initial_constant_power), haplotypes_per_read, hapl_variants, stream_window, queue_depth,
+                                                    executor, calculate_sw, summary, sampled ? &validator : nullptr);
+                // Progress messages before the reports
+                log_flush();
+                print_stream_report(report, cout);
+                if (calculate_sw) {
+                        print_verify_summary(summary, cout);
+                }
+                if (sampled) {
+                        print_sample_report(validator.report(), cout);
+                }
+
+                time_t t = chrono::system_clock::to_time_t(chrono::system_clock::now());
+                ofstream outfile("pairhmm_es" + std::to_string(ES) + "_" + std::to_string(CORES) + "core_" + std::to_string(pairs) + "_" + std::to_string(x) + "_" + std::to_string(y) + "_" + std::to_string(initial_constant_power) + ".txt", ios::out | ios::app);
+                outfile << endl << "===================" << endl;
+                outfile << ctime(&t) << endl;
+                outfile << "Pairs = " << pairs << endl;
+                outfile << "X = " << x << endl;
+                outfile << "Y = " << y << endl;
+                outfile << "Initial Constant = " << initial_constant_power << endl;
+                outfile << "Haplotypes per read = " << haplotypes_per_read << " (" << hapl_variants << " variants)" << endl;
+                outfile << "Streaming window = " << stream_window << " batches (queue depth " << queue_depth << ")" << endl;
+                outfile << setprecision(20) << fixed;
+                print_stream_report(report, outfile);
+                if (sampled) {
+                        print_sample_report(validator.report(), outfile);
+                }
+                outfile.close();
+
+                return 0;
+        }
+
+        workload = gen_workload(pairs, x, y);
+
         batches = std::vector<t_batch>(workload->batches);
         start = omp_get_wtime();
 
-        // Generate random basepair strings for reads and haplotypes
-        std::string x_string = randomBasepairs(workload->batches * (px(x, y) + x - 1));
-        std::string y_string = randomBasepairs(workload->batches * (py(y) + y - 1));
-
+        // Every batch is generated from its own counter-based random streams,
+        // so the workload is identical for any number of threads
+        #pragma omp parallel for schedule(dynamic)
         for (int q = 0; q < workload->batches; q++) {
-                fill_batch(batches[q], x_string, y_string, q, workload->bx[q], workload->by[q], powf(2.0, initial_constant_power)); // HW unit starts with last batch
+                fill_batch(batches[q], q, workload->bx[q], workload->by[q], powf(2.0, initial_constant_power),
+                           read_major_id(q, haplotypes_per_read), hapl_variants); // HW unit starts with last batch
         }
         stop = omp_get_wtime();
         t_fill_batch = stop - start;
 
-        PairHMMPosit pairhmm_posit(workload, show_results, show_table);
-        PairHMMFloat<float> pairhmm_float(workload, show_results, show_table);
-        PairHMMFloat<cpp_dec_float_100> pairhmm_dec50(workload, show_results, show_table);
+        if (explore) {
+                std::vector<t_format_point> points = explore_formats(batches, workload);
+                log_flush();
+                print_format_points(points, cout);
+
+                time_t t = chrono::system_clock::to_time_t(chrono::system_clock::now());
+                ofstream outfile("pairhmm_es" + std::to_string(ES) + "_" + std::to_string(CORES) + "core_" + std::to_string(pairs) + "_" + std::to_string(x) + "_" + std::to_string(y) + "_" + std::to_string(initial_constant_power) + ".txt", ios::out | ios::app);
+                outfile << endl << "===================" << endl;
+                outfile << ctime(&t) << endl;
+                outfile << "Pairs = " << pairs << endl;
+                outfile << "X = " << x << endl;
+                outfile << "Y = " << y << endl;
+                outfile << "Initial Constant = " << initial_constant_power << endl;
+                outfile << "Haplotypes per read = " << haplotypes_per_read << " (" << hapl_variants << " variants)" << endl;
+                outfile << "Number formats" << endl;
+                outfile << setprecision(20) << fixed;
+                print_format_points(points, outfile);
+                outfile.close();
+
+                return 0;
+        }
+
+        // Results of all engines and of the accelerator, one row per pair
+        ResultStore results(workload->pairs);
+
+        PairHMMPosit pairhmm_posit(workload, show_results, show_table, &results);
+        PairHMMFloat<float> pairhmm_float(workload, show_results, show_table, &results);
+        PairHMMFloat<cpp_dec_float_100> pairhmm_dec50(workload, show_results, show_table, &results);
+
+        // The reference always computes the full matrix
+        pairhmm_posit.set_band(band_width, band_offset);
+        pairhmm_float.set_band(band_width, band_offset);
+        pairhmm_posit.set_prefix_sharing(prefix_sharing);
+
+        PairHMMSmallPosit<16, P16_ES> pairhmm_p16(workload);
+        PairHMMSmallPosit<8, P8_ES> pairhmm_p8(workload);
+
+        // Batches that a previous run of the same parameters completed are
+        // restored from the checkpoint; all others are appended to it
+        Checkpoint checkpoint;
+        if (!checkpoint_file.empty()) {
+                t_checkpoint_run run;
+                memset(&run, 0, sizeof(run));
+                run.pairs = pairs;
+                run.x = x;
+                run.y = y;
+                run.initial_constant_power = initial_constant_power;
+                run.haplotypes_per_read = haplotypes_per_read;
+                run.hapl_variants = hapl_variants;
+                run.band_width = band_width;
+                run.band_offset = band_offset;
+                run.posit_nbits = NBITS;
+                run.posit_es = ES;
+                run.small_es = (P16_ES << 16) | P8_ES;
+
+                if (!checkpoint.open(checkpoint_file, run, workload->batches)) {
+                        return (EXIT_FAILURE);
+                }
+                LOG_INFO(LOG_MAIN, "Checkpoint %s: %zu batch results restored\n", checkpoint_file.c_str(), checkpoint.restored());
+
+                pairhmm_posit.set_checkpoint(&checkpoint, CHECKPOINT_POSIT);
+                pairhmm_float.set_checkpoint(&checkpoint, CHECKPOINT_FLOAT);
+                pairhmm_dec50.set_checkpoint(&checkpoint, CHECKPOINT_REFERENCE);
+                pairhmm_p16.set_checkpoint(&checkpoint, CHECKPOINT_P16);
+                pairhmm_p8.set_checkpoint(&checkpoint, CHECKPOINT_P8);
+        }
 
         if (calculate_sw) {
-                DEBUG_PRINT("Calculating on host...\n");
+                LOG_DEBUG(LOG_MAIN, "Calculating on host...\n");
 
                 start = omp_get_wtime();
                 pairhmm_posit.calculate(batches);
                 stop = omp_get_wtime();
                 t_sw = stop - start;
+                LOG_DEBUG(LOG_MAIN, "Read profiles: %lu built, %lu reused\n", (unsigned long) pairhmm_posit.profile.built,
+                            (unsigned long) pairhmm_posit.profile.reused);
 
                 start = omp_get_wtime();
                 pairhmm_float.calculate(batches);
@@ -137,165 +408,205 @@ int main(int argc, char ** argv)
                 pairhmm_dec50.calculate(batches);
                 stop = omp_get_wtime();
                 t_dec = stop - start;
+
+                if (small_posits) {
+                        start = omp_get_wtime();
+                        pairhmm_p16.calculate(batches);
+                        stop = omp_get_wtime();
+                        t_p16 = stop - start;
+
+                        start = omp_get_wtime();
+                        pairhmm_p8.calculate(batches);
+                        stop = omp_get_wtime();
+                        t_p8 = stop - start;
+                }
         }
 
-        DEBUG_PRINT("Creating Arrow table...\n");
-        start = omp_get_wtime();
-        // Make a table with haplotypes
-        shared_ptr<arrow::Table> table_hapl = create_table_hapl(batches);
-        // Create the read and probabilities columns
-        shared_ptr<arrow::Table> table_reads_reads = create_table_reads_reads(batches);
-        shared_ptr<arrow::Table> table_reads_probs = create_table_reads_probs(batches);
-        stop = omp_get_wtime();
-        t_fill_table = stop - start;
+        // Pairs longer than the accelerator supports are computed by the tiled host engine instead
+        bool tiled = y > MAX_BP_STRING;
 
-        // Calculate on FPGA
-        // Create a platform
-        shared_ptr<fletcher::SNAPPlatform> platform(new fletcher::SNAPPlatform());
+        // Accelerator results in batch order, or those of the tiled host engine
+        std::vector<uint32_t>& hw_bits = tiled ? results.tiled : results.hw;
+        int hw_engine = tiled ? CHECKPOINT_TILED : CHECKPOINT_HW;
 
-        DEBUG_PRINT("Preparing column buffers...\n");
-        // Prepare the colummn buffers
-        start = omp_get_wtime();
-        std::vector<std::shared_ptr<arrow::Column> > columns;
-        columns.push_back(table_hapl->column(0));
-        columns.push_back(table_reads_reads->column(0));
-        columns.push_back(table_reads_probs->column(0));
-        platform->prepare_column_chunks(columns); // This requires a modification in Fletcher (to accept vectors)
-        stop = omp_get_wtime();
-        t_prepare_column = stop - start;
+        // Per-platform reports of the sharded run, or the report of the hybrid run
+        std::vector<t_card_report> card_reports;
+        std::vector<t_cycle_report> cycle_reports;
+        t_hybrid_report hybrid_report = t_hybrid_report();
 
-        DEBUG_PRINT("Creating UserCore instance...\n");
-        start = omp_get_wtime();
-        // Create a UserCore
-        PairHMMUserCore uc(static_pointer_cast<fletcher::FPGAPlatform>(platform));
-
-        // Reset UserCore
-        uc.reset();
-
-        // Initial values for each core
-        std::vector<t_inits> inits(roundToMultiple(CORES, 2));
-        // Number of batches for each core
-        std::vector<uint32_t> batch_length(roundToMultiple(CORES, 2));
-        // X & Y length for each core
-        std::vector<uint32_t> x_len(roundToMultiple(CORES, 2));
-        std::vector<uint32_t> y_len(roundToMultiple(CORES, 2));
-
-        int batch_length_total = 0;
-        // Balance total batches over multiple cores
-        int avg_batches_per_core = floor((float)workload->batches / CORES);
-
-        for(int i = 0; i < roundToMultiple(CORES, 2); i++) {
-                // For now, duplicate batch information across all core MMIO registers
-                batch_length[i] = (i == 0 && workload->batches % avg_batches_per_core > 0) ? avg_batches_per_core + 1 : avg_batches_per_core; // Remainder of batches is done by first core
-                inits[i] = (i > CORES - 1) ? batches[0].init : batches[i].init;
-                x_len[i] = (i > CORES - 1) ? 0 : workload->bx[i];
-                y_len[i] = (i > CORES - 1) ? 0 : workload->by[i];
+        std::vector<shared_ptr<Accelerator> > accelerators;
+        if (!tiled) {
+                accelerators = create_accelerators(cards, emulated, numa_node, deadline);
+                max_cups = MAX_CUPS_HW * accelerators.size();
         }
 
-        // Write result buffer addresses
-        // Create arrays for results to be written to (per SA core)
-        std::vector<uint32_t *> result_hw(roundToMultiple(CORES, 2));
-        for(int i = 0; i < roundToMultiple(CORES, 2); i++) {
-                rc = posix_memalign((void * * ) &(result_hw[i]), BURST_LENGTH, sizeof(uint32_t) * roundToMultiple(batch_length[i], 2) * PIPE_DEPTH);
-                // clear values buffer
-                for (uint32_t j = 0; j < roundToMultiple(batch_length[i], 2) * PIPE_DEPTH; j++) {
-                        result_hw[i][j] = 0xDEADBEEF;
+        // Computes a set of batches; the times and reports add up over the runs
+        t_fill_table = t_prepare_column = t_create_core = t_fpga = 0.0;
+        t_batch_executor run_hw = [&](std::vector<t_batch>& run_batches, const std::vector<int>& selection, t_workload *run_workload) {
+                std::vector<uint32_t> bits;
+
+                if (tiled) {
+                        // Pairs longer than the accelerator supports are split into
+                        // haplotype-column tiles, with the boundary column carried from
+                        // tile to tile. The bitstream has no boundary column interface
+                        // yet, so the tile jobs run on the host.
+                        LOG_DEBUG(LOG_MAIN, "Y > MAX_BP_STRING, computing %d-column tiles...\n", TILE_COLS);
+                        HostTileExecutor executor;
+                        start = omp_get_wtime();
+                        bits = calculate_tiled(run_batches, selection, run_workload, executor);
+                        stop = omp_get_wtime();
+                        t_tiled += stop - start;
+                } else if (cpu_threads > 0) {
+                        // Calculate on the cards and on the CPU at the same time, sharing one queue of batches
+                        HybridExecutor executor(cpu_threads, cpu_kernel);
+                        for (shared_ptr<Accelerator>& acc : accelerators) {
+                                executor.add(acc);
+                        }
+
+                        bits = executor.run(run_batches, selection, run_workload);
+                        add_hybrid_report(hybrid_report, executor.report);
+                        t_fpga += executor.report.t_total;
+
+                        print_hybrid_report(executor.report, cout);
+                } else {
+                        // Calculate on the cards (and emulated cards), with the batches sharded over them
+                        ShardScheduler scheduler;
+                        for (shared_ptr<Accelerator>& acc : accelerators) {
+                                scheduler.add(acc);
+                        }
+
+                        bits = scheduler.run(run_batches, selection, run_workload);
+
+                        // The platforms run concurrently, so the slowest one determines the time
+                        double fill_table = 0.0, prepare_column = 0.0, create_core = 0.0, run_time = 0.0;
+                        std::vector<t_cycle_report> run_cycle_reports;
+                        for (t_card_report& r : scheduler.reports) {
+                                fill_table = max(fill_table, r.t_fill_table);
+                                prepare_column = max(prepare_column, r.t_prepare_column);
+                                create_core = max(create_core, r.t_create_core);
+                                run_time = max(run_time, r.t_run);
+                                if (r.batches > 0) {
+                                        run_cycle_reports.push_back(r.model);
+                                }
+                        }
+                        t_fill_table += fill_table;
+                        t_prepare_column += prepare_column;
+                        t_create_core += create_core;
+                        t_fpga += run_time;
+
+                        print_card_reports(scheduler.reports, cout);
+
+                        // Predicted against measured time of every card, and where the PE-cycles went
+                        print_cycle_reports(run_cycle_reports, cout);
+
+                        card_reports.insert(card_reports.end(), scheduler.reports.begin(), scheduler.reports.end());
+                        cycle_reports.insert(cycle_reports.end(), run_cycle_reports.begin(), run_cycle_reports.end());
                 }
 
-                addr_lohi val;
-                val.full = (uint64_t) result_hw[i];
-                platform->write_mmio(REG_RESULT_DATA_OFFSET + i, val.full);
-        }
-        stop = omp_get_wtime();
-        t_create_core = stop - start;
+                return bits;
+        };
 
-        // Configure the pair HMM SA cores
-        uc.set_batch_init(batch_length, inits, x_len, y_len);
+        // Cells computed on the accelerators by this process
+        uint64_t cups_hw = workload->cups;
 
-        std::vector<uint32_t> batch_offsets;
-        batch_offsets.resize(roundToMultiple(CORES, 2));
-        int batch_counter = 0;
-        for(int i = 0; i < roundToMultiple(CORES, 2); i++) {
-                batch_offsets[i] = batch_counter;
-                batch_counter = batch_counter + batch_length[i];
-        }
-        uc.set_batch_offsets(batch_offsets);
+        if (!checkpoint.is_open()) {
+                hw_bits = run_hw(batches, all_batches(workload), workload);
+        } else {
+                // Only the batches that are not in the checkpoint, in runs of
+                // checkpoint_interval batches that are each appended when done
+                std::vector<int> pending = checkpoint.pending(hw_engine);
+                for (int b = 0; b < workload->batches; b++) {
+                        const t_checkpoint_record *r = checkpoint.find(hw_engine, b);
+                        for (int j = 0; r != nullptr && j < PIPE_DEPTH; j++) {
+                                hw_bits[b * PIPE_DEPTH + j] = (uint32_t) r->values[j][0];
+                        }
+                }
 
-        // Run
-        DEBUG_PRINT("Starting accelerator computation...\n");
-        start = omp_get_wtime();
-        uc.start();
-
-        uc.wait_for_finish();
-
-        // Wait for last result of last SA core
-        do {
-                // for(int i = 0; i < CORES; i++) {
-                //         cout << "==================================" << endl;
-                //         cout << "== CORE " << i << endl;
-                //         cout << "==================================" << endl;
-                //         for(int j = 0; j < batch_length[i] * PIPE_DEPTH; j++) {
-                //                 cout << dec << j <<": " << hex << result_hw[i][j] << dec <<endl;
-                //         }
-                //         cout << "==================================" << endl;
-                //         cout << endl;
-                // }
-
-                usleep(1);
-        }
-        while ((result_hw[CORES - 1][batch_length[CORES - 1] * PIPE_DEPTH - 1] == 0xDEADBEEF));
-        stop = omp_get_wtime();
-        t_fpga = stop - start;
-
-        for(int i = 0; i < CORES; i++) {
-                cout << "==================================" << endl;
-                cout << "== CORE " << i << endl;
-                cout << "==================================" << endl;
-                for(int j = 0; j < batch_length[i] * PIPE_DEPTH; j++) {
-                        cout << dec << j <<": " << hex << result_hw[i][j] << dec <<endl;
+                cups_hw = 0;
+                for (size_t first = 0; first < pending.size(); first += checkpoint_interval) {
+                        std::vector<int> run(pending.begin() + first, pending.begin() + min(pending.size(), first + checkpoint_interval));
+                        t_workload *run_workload = select_workload(workload, run);
+
+                        // The batches of the run are computed in place
+                        std::vector<uint32_t> bits = run_hw(batches, run, run_workload);
+                        for (size_t i = 0; i < run.size(); i++) {
+                                t_checkpoint_record r = checkpoint_record(hw_engine, run[i]);
+                                for (int j = 0; j < PIPE_DEPTH; j++) {
+                                        hw_bits[run[i] * PIPE_DEPTH + j] = bits[i * PIPE_DEPTH + j];
+                                        r.values[j][0] = bits[i * PIPE_DEPTH + j];
+                                }
+                                checkpoint.append(r);
+                        }
+                        checkpoint.sync();
+
+                        cups_hw += run_workload->cups;
+                        free_workload(run_workload);
                 }
-                cout << "==================================" << endl;
-                cout << endl;
         }
 
+        // Progress messages before the reports
+        log_flush();
+
         // Check for errors with SW calculation
         if (calculate_sw) {
                 DebugValues<posit<NBITS, ES> > hw_debug_values;
 
-                for (int c = 0; c < CORES; c++) {
-                        for (int i = 0; i < batch_length[c]; i++) {
-                                for(int j = 0; j < PIPE_DEPTH; j++) {
-                                        // Store HW posit result for decimal accuracy calculation
-                                        posit<NBITS, ES> res_hw;
-                                        res_hw.set_raw_bits(result_hw[c][i * PIPE_DEPTH + j]);
-                                        hw_debug_values.debugValue(res_hw, "result[%d][%d]", batch_offsets[c] + (batch_length[c] - i - 1), j);
-                                }
+                for (int i = 0; i < workload->batches; i++) {
+                        for(int j = 0; j < PIPE_DEPTH; j++) {
+                                // Store HW posit result for decimal accuracy calculation
+                                posit<NBITS, ES> res_hw;
+                                res_hw.set_raw_bits(hw_bits[i * PIPE_DEPTH + j]);
+                                hw_debug_values.debugValue(res_hw, "result[%d][%d]", i, j);
                         }
                 }
 
-                cout << "Writing benchmark file..." << endl;
+                std::vector<std::pair<std::string, DebugValues<double> *> > small_values;
+                if (small_posits) {
+                        small_values.push_back(std::make_pair(pairhmm_p16.name(), &pairhmm_p16.debug_values));
+                        small_values.push_back(std::make_pair(pairhmm_p8.name(), &pairhmm_p8.debug_values));
+                }
+
+                LOG_INFO(LOG_MAIN, "Writing benchmark file...\n");
                 writeBenchmark(pairhmm_dec50, pairhmm_float, pairhmm_posit, hw_debug_values,
                                "pairhmm_es" + std::to_string(ES) + "_" + std::to_string(CORES) + "core_" + std::to_string(pairs) + "_" + std::to_string(x) + "_" + std::to_string(y) + "_" + std::to_string(initial_constant_power) + ".txt",
-                               false, true);
+                               false, true, small_values, tiled ? "tiled" : "hw");
+
+                LOG_DEBUG(LOG_VERIFY, "Checking posit decoder...\n");
+                uint64_t decoder_errors = check_posit_decoder();
+                if (decoder_errors > 0) {
+                        LOG_ERROR(LOG_VERIFY, "ERROR: posit decoder differs from the posit library for %lu values\n", (unsigned long) decoder_errors);
+                }
+
+                if (small_posits) {
+                        LOG_DEBUG(LOG_VERIFY, "Checking narrow posit tables...\n");
+                        uint64_t table_errors = check_small_posits();
+                        if (table_errors > 0) {
+                                LOG_ERROR(LOG_VERIFY, "ERROR: narrow posit arithmetic differs from the posit library for %lu operations\n", (unsigned long) table_errors);
+                        }
+                }
 
-                DEBUG_PRINT("Checking errors...\n");
-                int errs_posit = 0;
-                errs_posit = pairhmm_posit.count_errors(batch_offsets, batch_length, result_hw);
-                DEBUG_PRINT("Posit errors: %d\n", errs_posit);
+                LOG_DEBUG(LOG_VERIFY, "Checking errors...\n");
+                std::vector<uint32_t> sw_bits = pairhmm_posit.result_bits();
+                t_verify_summary summary = verify_results(sw_bits.data(), hw_bits.data(), hw_bits.size());
+                print_verify_summary(summary, cout);
+                LOG_DEBUG(LOG_VERIFY, "Posit errors: %d\n", (int) summary.errors);
         }
 
-        cout << "Resetting user core..." << endl;
-        // Reset UserCore
-        uc.reset();
+        if (sampled) {
+                LOG_DEBUG(LOG_VERIFY, "Validating a sample of the batches...\n");
+                validator.validate(batches, workload, hw_bits, tiled ? t_tiled : t_fpga);
+                print_sample_report(validator.report(), cout);
+        }
 
-        float p_fpga      = ((double)workload->cups / (double)t_fpga)  / 1000000; // in MCUPS
-        float p_sw        = ((double)workload->cups / (double)t_sw)    / 1000000; // in MCUPS
-        float p_float     = ((double)workload->cups / (double)t_float) / 1000000; // in MCUPS
-        float p_dec       = ((double)workload->cups / (double)t_dec)   / 1000000; // in MCUPS
-        float utilization = ((double)workload->cups / (double)t_fpga)  / max_cups;
-        float speedup     = t_sw / t_fpga;
+        float p_fpga      = t_fpga > 0  ? ((double)cups_hw / (double)t_fpga)  / 1000000 : 0; // in MCUPS, 0 if all batches were restored
+        float p_sw        = t_sw > 0    ? ((double)workload->cups / (double)t_sw)    / 1000000 : 0; // in MCUPS, 0 if not computed
+        float p_float     = t_float > 0 ? ((double)workload->cups / (double)t_float) / 1000000 : 0; // in MCUPS
+        float p_dec       = t_dec > 0   ? ((double)workload->cups / (double)t_dec)   / 1000000 : 0; // in MCUPS
+        float p_tiled     = t_tiled > 0 ? ((double)cups_hw / (double)t_tiled) / 1000000 : 0; // in MCUPS, on the host
+        float utilization = max_cups > 0 && t_fpga > 0 ? ((double)cups_hw / (double)t_fpga) / max_cups : 0; // CPU-only hybrid runs have no card
+        float speedup     = t_fpga > 0  ? t_sw / t_fpga : 0;
 
-        cout << "Adding timing data..." << endl;
+        LOG_INFO(LOG_MAIN, "Adding timing data...\n");
         time_t t = chrono::system_clock::to_time_t(chrono::system_clock::now());
         ofstream outfile("pairhmm_es" + std::to_string(ES) + "_" + std::to_string(CORES) + "core_" + std::to_string(pairs) + "_" + std::to_string(x) + "_" + std::to_string(y) + "_" + std::to_string(initial_constant_power) + ".txt", ios::out | ios::app);
         outfile << endl << "===================" << endl;
@@ -304,9 +615,37 @@ int main(int argc, char ** argv)
         outfile << "X = " << x << endl;
         outfile << "Y = " << y << endl;
         outfile << "Initial Constant = " << initial_constant_power << endl;
-        outfile << "cups,t_fill_batch,t_fill_table,t_prepare_column,t_create_core,t_fpga,p_fpga,t_sw,p_sw,t_float,p_float,t_dec,p_dec,utilization,speedup" << endl;
-        outfile << setprecision(20) << fixed << workload->cups <<","<< t_fill_batch <<","<< t_fill_table <<","<< t_prepare_column <<","<< t_create_core <<","<< t_fpga <<","<< p_fpga <<","<< t_sw <<","<< p_sw <<","<< t_float <<","<< p_float <<","<< t_dec <<","<< p_dec <<","<< utilization <<","<< speedup << endl;
+        outfile << "Band = " << band_width << " (alignment start " << band_offset << ")" << endl;
+        outfile << "Haplotypes per read = " << haplotypes_per_read << " (" << hapl_variants << " variants, prefix sharing " << (prefix_sharing ? "on" : "off") << ")" << endl;
+        outfile << "cups,t_fill_batch,t_fill_table,t_prepare_column,t_create_core,t_fpga,p_fpga,t_sw,p_sw,t_float,p_float,t_dec,p_dec,utilization,speedup,cells_sw,cells_skipped_sw,band_leak_max" << endl;
+        outfile << setprecision(20) << fixed << workload->cups <<","<< t_fill_batch <<","<< t_fill_table <<","<< t_prepare_column <<","<< t_create_core <<","<< t_fpga <<","<< p_fpga <<","<< t_sw <<","<< p_sw <<","<< t_float <<","<< p_float <<","<< t_dec <<","<< p_dec <<","<< utilization <<","<< speedup <<","
+                << pairhmm_posit.cells_total <<","<< pairhmm_posit.cells_total - pairhmm_posit.cells_computed <<","<< pairhmm_posit.band_leak_max << endl;
+        if ((small_posits && calculate_sw) || tiled) {
+                outfile << "engine,t_engine,p_engine" << endl;
+        }
+        if (tiled) {
+                outfile << "tiled" <<","<< t_tiled <<","<< p_tiled << endl;
+        }
+        if (small_posits && calculate_sw) {
+                outfile << pairhmm_p16.name() <<","<< t_p16 <<","<< (t_p16 > 0 ? ((double)workload->cups / t_p16) / 1000000 : 0) << endl;
+                outfile << pairhmm_p8.name() <<","<< t_p8 <<","<< (t_p8 > 0 ? ((double)workload->cups / t_p8) / 1000000 : 0) << endl;
+        }
+        if (!card_reports.empty()) {
+                print_card_reports(card_reports, outfile);
+                print_cycle_reports(cycle_reports, outfile);
+        }
+        if (cpu_threads > 0 && !tiled) {
+                print_hybrid_report(hybrid_report, outfile);
+        }
+        if (sampled) {
+                print_sample_report(validator.report(), outfile);
+        }
         outfile.close();
 
+        if (!results_file.empty()) {
+                LOG_INFO(LOG_MAIN, "Writing results to %s...\n", results_file.c_str());
+                results.write(results_file);
+        }
+
         return 0;
 }
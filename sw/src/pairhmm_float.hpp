@@ -6,6 +6,7 @@
 #define PAIRHMM_FLOAT_HPP
 
 #include <iostream>
+#include <type_traits>
 #include <vector>
 #include <posit/posit>
 
@@ -13,6 +14,9 @@
 #include "defines.hpp"
 #include "utils.hpp"
 #include "batch.hpp"
+#include "read_profile.hpp"
+#include "result_store.hpp"
+#include "checkpoint.hpp"
 
 using namespace std;
 using namespace sw::unum;
@@ -23,53 +27,58 @@ typedef vector<T> t_result_sw;
 typedef vector<t_result_sw> t_matrix;
 
 private:
-std::vector<t_result_sw> result_sw, result_sw_m, result_sw_i;
+// Results go to the shared store, or to an own one without it
+ResultStore own_results;
+ResultStore *results;
 t_workload *workload;
 bool show_results, show_table;
+int band_width = 0, band_offset = 0;
+Checkpoint *checkpoint = nullptr;
+int checkpoint_engine = 0;
 
 public:
 DebugValues<T> debug_values;
 
-PairHMMFloat(t_workload *wl, bool show_results, bool show_table) : workload(wl), show_results(show_results),
-        show_table(show_table) {
-        result_sw.resize(workload->batches * (PIPE_DEPTH + 1));
-        result_sw_m.resize(workload->batches * (PIPE_DEPTH + 1));
-        result_sw_i.resize(workload->batches * (PIPE_DEPTH + 1));
-        for (int i = 0; i < workload->batches * (PIPE_DEPTH + 1); i++) {
-                result_sw[i] = t_result_sw(3, 0);
-                result_sw_m[i] = t_result_sw(3, 0);
-                result_sw_i[i] = t_result_sw(3, 0);
-        }
+// Cell statistics, and the largest estimated fraction of a result's
+// probability mass that fell outside the band
+uint64_t cells_total = 0, cells_computed = 0;
+double band_leak_max = 0.0;
+
+// Decoded coefficients of the last read, reused while batches share it
+ReadProfile<T> profile;
+
+PairHMMFloat(t_workload *wl, bool show_results, bool show_table, ResultStore *store = nullptr)
+        : own_results(store ? 0 : wl->batches * PIPE_DEPTH), results(store ? store : &own_results), workload(wl),
+        show_results(show_results), show_table(show_table) {
 }
 
-void calculate(std::vector<t_batch>& batches) {
-        for (int i = 0; i < workload->batches; i++) {
-                int x = workload->bx[i];
-                int y = workload->by[i];
+PairHMMFloat(const PairHMMFloat&) = delete;
+PairHMMFloat& operator=(const PairHMMFloat&) = delete;
 
-                t_matrix M(x + 1, vector<T>(y + 1));
-                t_matrix I(x + 1, vector<T>(y + 1));
-                t_matrix D(x + 1, vector<T>(y + 1));
+// Result of a pair, as stored in the column of this engine
+double result(int row) {
+        return (double) ResultStore::float_column<T>::of(*results)[row];
+}
 
-                // Calculate results
-                for (int j = 0; j < PIPE_DEPTH; j++) {
-                        calculate_mids(batches[i], j, x, y, M, I, D);
-
-                        // result_sw[i * PIPE_DEPTH + j][0] = 0.0;
-                        result_sw[i * PIPE_DEPTH + j][0] = 0.0;
-                        result_sw_m[i * PIPE_DEPTH + j][0] = 0.0;
-                        result_sw_i[i * PIPE_DEPTH + j][0] = 0.0;
-                        for (int c = 1; c < y + 1; c++) {
-                                result_sw_m[i * PIPE_DEPTH + j][0] += M[x][c];
-                                result_sw_i[i * PIPE_DEPTH + j][0] += I[x][c];
-                        }
-                        result_sw[i*PIPE_DEPTH+j][0] = result_sw_m[i * PIPE_DEPTH + j][0] + result_sw_i[i * PIPE_DEPTH + j][0];
+// Only compute cells within width of the diagonal that starts at haplotype
+// column offset (the alignment start). A width of zero computes the full matrix.
+void set_band(int width, int offset) {
+        band_width = width;
+        band_offset = offset;
+}
 
-                        debug_values.debugValue(result_sw[i * PIPE_DEPTH + j][0], "result[%d][%d]", i, j);//(i * PIPE_DEPTH + j));
+// Restore the batches that are in the checkpoint instead of computing
+// them, and append the results of the others to it
+void set_checkpoint(Checkpoint *c, int engine) {
+        checkpoint = c;
+        checkpoint_engine = engine;
+}
 
-                        if (show_table) {
-                                print_mid_table(batches[i], j, x, y, M, I, D);
-                        }
+void calculate(std::vector<t_batch>& batches) {
+        for (int i = 0; i < workload->batches; i++) {
+                if (!restore_batch(i)) {
+                        calculate_batch(batches[i], i);
+                        save_batch(i);
                 }
         }
 
@@ -78,11 +87,78 @@ void calculate(std::vector<t_batch>& batches) {
         }
 }
 
-void calculate_mids(t_batch& batch, int pair, int x, int y, t_matrix& M, t_matrix& I, t_matrix& D) {
+// Compute the pairs of batch i of the workload
+void calculate_batch(t_batch& batch, int i) {
+        int x = workload->bx[i];
+        int y = workload->by[i];
+
+        t_matrix M(x + 1, vector<T>(y + 1));
+        t_matrix I(x + 1, vector<T>(y + 1));
+        t_matrix D(x + 1, vector<T>(y + 1));
+
+        profile.update(batch);
+
+        // Calculate results
+        for (int j = 0; j < PIPE_DEPTH; j++) {
+                T leak = calculate_mids(batch, j, x, y, M, I, D);
+
+                T sum_m = 0.0, sum_i = 0.0;
+                for (int c = 1; c < y + 1; c++) {
+                        sum_m += M[x][c];
+                        sum_i += I[x][c];
+                }
+                T result = sum_m + sum_i;
+
+                auto& column = ResultStore::float_column<T>::of(*results);
+                column[i * PIPE_DEPTH + j] = static_cast<typename std::remove_reference<decltype(column)>::type::value_type>(result);
+
+                if (band_width > 0 && (double) leak > 0.0) {
+                        double rel_leak = (double) leak / ((double) result + (double) leak);
+                        band_leak_max = max(band_leak_max, rel_leak);
+                }
+
+                debug_values.debugValue(result, "result[%d][%d]", i, j);//(i * PIPE_DEPTH + j));
+
+                if (show_table) {
+                        print_mid_table(batch, j, x, y, M, I, D);
+                }
+        }
+}
+
+// Results of batch i from the checkpoint; false if it has to be computed
+bool restore_batch(int i) {
+        const t_checkpoint_record *r = checkpoint ? checkpoint->find(checkpoint_engine, i) : nullptr;
+        if (r == nullptr) {
+                return false;
+        }
+
+        auto& column = ResultStore::float_column<T>::of(*results);
+        for (int j = 0; j < PIPE_DEPTH; j++) {
+                T result = static_cast<T>(join_value(r->values[j]));
+                column[i * PIPE_DEPTH + j] = static_cast<typename std::remove_reference<decltype(column)>::type::value_type>(result);
+                debug_values.debugValue(result, "result[%d][%d]", i, j);
+        }
+        return true;
+}
+
+// The results of a batch are the last PIPE_DEPTH debug values
+void save_batch(int i) {
+        if (checkpoint == nullptr) {
+                return;
+        }
+
+        t_checkpoint_record r = checkpoint_record(checkpoint_engine, i);
+        size_t first = debug_values.items.size() - PIPE_DEPTH;
+        for (int j = 0; j < PIPE_DEPTH; j++) {
+                split_value(debug_values.items[first + j].value, r.values[j]);
+        }
+        checkpoint->append(r);
+}
+
+// Returns an estimate of the probability mass that flowed out of the band
+T calculate_mids(t_batch& batch, int pair, int x, int y, t_matrix& M, t_matrix& I, t_matrix& D) {
         t_inits& init = batch.init;
-        std::vector<t_bbase>& read = batch.read;
-        std::vector<t_bbase>& hapl = batch.hapl;
-        std::vector<t_probs>& prob = batch.prob;
+        PackedBases& hapl = batch.hapl;
 
         posit<NBITS, ES> initial;
         initial.set_raw_bits(init.initials[pair]);
@@ -91,7 +167,7 @@ void calculate_mids(t_batch& batch, int pair, int x, int y, t_matrix& M, t_matri
         for (int j = 0; j < y + 1; j++) {
                 M[0][j] = 0;
                 I[0][j] = 0;
-                D[0][j] = (T) initial;
+                D[0][j] = engine_value<T>::of(initial);
         }
 
         // Set to zero in Y direction
@@ -101,39 +177,77 @@ void calculate_mids(t_batch& batch, int pair, int x, int y, t_matrix& M, t_matri
                 D[i][0] = 0;
         }
 
-        posit<NBITS, ES> distm_simi, distm_diff, alpha, beta, delta, epsilon, zeta, eta, distm;
+        // One-hot haplotype bases of this pair; with the match codes of a row they select the prior
+        std::vector<uint8_t> hb(y);
+        hapl.unpack_onehot(pair, y, hb.data());
+
+        // Columns lo ... hi of each row are computed, cells outside the band
+        // are never written and stay zero
+        int lo = 1, hi = y;
+        T leak = 0;
+
+        T alpha, beta, delta, epsilon, zeta, eta, distm;
         for (int i = 1; i < x + 1; i++) {
-                unsigned char rb = read[i - 1 + pair].base;
-
-                eta.set_raw_bits(prob[(i - 1) + pair].p[0].b);
-                zeta.set_raw_bits(prob[(i - 1) + pair].p[1].b);
-                epsilon.set_raw_bits(prob[(i - 1) + pair].p[2].b);
-                delta.set_raw_bits(prob[(i - 1) + pair].p[3].b);
-                beta.set_raw_bits(prob[(i - 1) + pair].p[4].b);
-                alpha.set_raw_bits(prob[(i - 1) + pair].p[5].b);
-                distm_diff.set_raw_bits(prob[(i - 1) + pair].p[6].b);
-                distm_simi.set_raw_bits(prob[(i - 1) + pair].p[7].b);
-
-                for (int j = 1; j < y + 1; j++) {
-                        unsigned char hb = hapl[j - 1 + pair].base;
-
-                        if (rb == hb || rb == 'N' || hb == 'N') {
-                                distm = distm_simi;
-                        } else {
-                                distm = distm_diff;
+                // Coefficients of read position (i - 1) + pair, from the profile of the read
+                int pos = (i - 1) + pair;
+                const T *prior = profile.priors(pos);
+                uint32_t codes = profile.match_codes(pos);
+
+                eta = profile.eta[pos];
+                zeta = profile.zeta[pos];
+                epsilon = profile.epsilon[pos];
+                delta = profile.delta[pos];
+                beta = profile.beta[pos];
+                alpha = profile.alpha[pos];
+
+                if (band_width > 0) {
+                        lo = max(1, i + band_offset - band_width);
+                        hi = min(y, i + band_offset + band_width);
+
+                        // Mass that would have entered, or left, the band in this row
+                        if (i == 1) {
+                                for (int j = 1; j < y + 1; j++) {
+                                        if (j < lo || j > hi) {
+                                                leak += prior[(codes >> hb[j - 1]) & 1] * (beta * D[0][j - 1]);
+                                        }
+                                }
+                        } else if (lo > 1 && lo <= y + 1) {
+                                leak += delta * M[i - 1][lo - 1] + epsilon * I[i - 1][lo - 1];
                         }
+                }
+                cells_total += y;
+                cells_computed += max(0, hi - lo + 1);
+
+                for (int j = lo; j < hi + 1; j++) {
+                        distm = prior[(codes >> hb[j - 1]) & 1];
 
-                        M[i][j] = (T)distm * ((T)alpha * M[i - 1][j - 1] + (T)beta * I[i - 1][j - 1] + (T)beta * D[i - 1][j - 1]);
-                        I[i][j] = (T)delta * M[i - 1][j] + (T)epsilon * I[i - 1][j];
-                        D[i][j] = (T)zeta * M[i][j - 1] + (T)eta * D[i][j - 1];
+                        M[i][j] = distm * (alpha * M[i - 1][j - 1] + beta * I[i - 1][j - 1] + beta * D[i - 1][j - 1]);
+                        I[i][j] = delta * M[i - 1][j] + epsilon * I[i - 1][j];
+                        D[i][j] = zeta * M[i][j - 1] + eta * D[i][j - 1];
+                }
+
+                if (band_width > 0 && hi >= lo && hi < y) {
+                        leak += zeta * M[i][hi] + eta * D[i][hi];
                 }
         }
+
+        return leak;
 }     // calculate_mids
 
+// Results rounded to the posit format of the accelerator, as raw bits
+std::vector<uint32_t> result_bits() {
+        std::vector<uint32_t> bits(workload->batches * PIPE_DEPTH);
+        for (int i = 0; i < workload->batches * PIPE_DEPTH; i++) {
+                posit<NBITS, ES> p(result(i));
+                bits[i] = to_uint(p);
+        }
+        return bits;
+}     // result_bits
+
 void print_mid_table(t_batch& batch, int pair, int r, int c, t_matrix& M, t_matrix& I, t_matrix& D) {
         int w = c + 1;
-        std::vector<t_bbase>& read = batch.read;
-        std::vector<t_bbase>& hapl = batch.hapl;
+        PackedBases& read = batch.read;
+        PackedBases& hapl = batch.hapl;
 
         T res[3];
 
@@ -146,7 +260,7 @@ void print_mid_table(t_batch& batch, int pair, int r, int c, t_matrix& M, t_matr
         printf("\n");
         printf("    ║");
         for (uint32_t i = 0; i < c + 1; i++) {
-                printf("      %5d , %c           ║", i, (i > 0) ? (hapl[i - 1 + pair].base) : '-');
+                printf("      %5d , %c           ║", i, (i > 0) ? hapl.at(i - 1 + pair) : '-');
         }
         printf("\n");
         printf("%3d ║", pair);
@@ -167,7 +281,7 @@ void print_mid_table(t_batch& batch, int pair, int r, int c, t_matrix& M, t_matr
 
         // loop over rows
         for (uint32_t j = 0; j < r + 1; j++) {
-                printf("%2d,%c║", j, (j > 0) ? (read[j - 1 + pair].base) : ('-'));
+                printf("%2d,%c║", j, (j > 0) ? read.at(j - 1 + pair) : ('-'));
                 // loop over columns
                 for (uint32_t i = 0; i < c + 1; i++) {
                         printf("%08X %08X %08X║", (float) M[j][i], (float) I[j][i], (float) D[j][i]);
@@ -211,13 +325,9 @@ void print_results() {
                 cout << "╠═════════════════════════════════════╣" << endl;
                 for (int j = 0; j < PIPE_DEPTH; j++) {
                         printf("║%2d: ", j);
-                        cout << setw(10) << result_sw[i * PIPE_DEPTH + j][0];
-                        cout << " ";
-                        cout << setw(10) << result_sw[i * PIPE_DEPTH + j][1];
-                        cout << " ";
-                        cout << setw(10) << result_sw[i * PIPE_DEPTH + j][2];
+                        cout << setw(32) << result(i * PIPE_DEPTH + j);
                         cout << " ║       ";
-                        cout << setprecision(10) << result_sw[i * PIPE_DEPTH + j][0];
+                        cout << setprecision(10) << result(i * PIPE_DEPTH + j);
                         cout << endl;
                 }
                 cout << "╚═════════════════════════════════════╝" << endl;
@@ -14,6 +14,10 @@
 #include "defines.hpp"
 #include "utils.hpp"
 #include "batch.hpp"
+#include "read_profile.hpp"
+#include "prefix.hpp"
+#include "result_store.hpp"
+#include "checkpoint.hpp"
 
 using namespace std;
 using namespace sw::unum;
@@ -23,77 +27,213 @@ class PairHMMPosit {
     typedef vector<t_result_sw> t_matrix;
 
 private:
-    std::vector<t_result_sw> result_sw, result_sw_m, result_sw_i;
+    // Results go to the shared store, or to an own one without it
+    ResultStore own_results;
+    ResultStore *results;
     t_workload *workload;
     bool show_results, show_table;
+    int band_width = 0, band_offset = 0;
+    bool prefix_sharing = false;
+    Checkpoint *checkpoint = nullptr;
+    int checkpoint_engine = CHECKPOINT_POSIT;
 
 public:
     DebugValues<posit<NBITS, ES>> debug_values;
 
-    PairHMMPosit(t_workload *wl, bool show_results, bool show_table) : workload(wl), show_results(show_results),
-                                                                       show_table(show_table) {
-        result_sw.resize(workload->batches * (PIPE_DEPTH + 1));
-        result_sw_m.resize(workload->batches * (PIPE_DEPTH + 1));
-        result_sw_i.resize(workload->batches * (PIPE_DEPTH + 1));
-        for(int i = 0; i < workload->batches * (PIPE_DEPTH + 1); i++) {
-            result_sw[i] = t_result_sw(3, 0);
-            result_sw_m[i] = t_result_sw(3, 0);
-            result_sw_i[i] = t_result_sw(3, 0);
-        }
+    // Cell statistics, and the largest estimated fraction of a result's
+    // probability mass that fell outside the band
+    uint64_t cells_total = 0, cells_computed = 0;
+    double band_leak_max = 0.0;
+
+    // Decoded coefficients of the last read, reused while batches share it
+    ReadProfile<posit<NBITS, ES>> profile;
+
+    PairHMMPosit(t_workload *wl, bool show_results, bool show_table, ResultStore *store = nullptr)
+            : own_results(store ? 0 : wl->batches * PIPE_DEPTH), results(store ? store : &own_results), workload(wl),
+              show_results(show_results), show_table(show_table) {
     }
 
-    void calculate(std::vector<t_batch>& batches) {
-        for(int i = 0; i < workload->batches; i++) {
-            int x = workload->bx[i];
-            int y = workload->by[i];
+    PairHMMPosit(const PairHMMPosit&) = delete;
+    PairHMMPosit& operator=(const PairHMMPosit&) = delete;
 
-            t_matrix M(x + 1, vector<posit<NBITS, ES>>(y + 1));
-            t_matrix I(x + 1, vector<posit<NBITS, ES>>(y + 1));
-            t_matrix D(x + 1, vector<posit<NBITS, ES>>(y + 1));
+    // Only compute cells within width of the diagonal that starts at haplotype
+    // column offset (the alignment start). A width of zero computes the full matrix.
+    void set_band(int width, int offset) {
+        band_width = width;
+        band_offset = offset;
+    }
 
-            // Calculate results
-            for(int j = 0; j < PIPE_DEPTH; j++) {
-                calculate_mids(batches[i], j, x, y, M, I, D);
-
-                result_sw[i * PIPE_DEPTH + j][0] = 0.0;
-                result_sw_m[i * PIPE_DEPTH + j][0] = 0.0;
-                result_sw_i[i * PIPE_DEPTH + j][0] = 0.0;
-                for(int c = 1; c < y + 1; c++) {
-                    result_sw_m[i * PIPE_DEPTH + j][0] += M[x][c];
-                    // if(i*PIPE_DEPTH+j == 0) {
-                    //     cout << "+= " << hexstring(M[x][c].collect()) << " --> " << hexstring(result_sw_m[i * PIPE_DEPTH + j][0].collect()) << endl;
-                    // }
-
-                    result_sw_i[i * PIPE_DEPTH + j][0] += I[x][c];
-                    // if(i*PIPE_DEPTH+j == 0) {
-                    //     cout << "+= " << hexstring(I[x][c].collect()) << " --> " << hexstring(result_sw_i[i * PIPE_DEPTH + j][0].collect()) << endl;
-                    // }
+    // Share the columns of common haplotype prefixes between the batches of a
+    // read. Only used for the full matrix; no tables are printed in this mode.
+    void set_prefix_sharing(bool enable) {
+        prefix_sharing = enable;
+    }
+
+    // Restore the batches that are in the checkpoint instead of computing
+    // them, and append the results of the others to it
+    void set_checkpoint(Checkpoint *c, int engine = CHECKPOINT_POSIT) {
+        checkpoint = c;
+        checkpoint_engine = engine;
+    }
+
+    void calculate(std::vector<t_batch>& batches) {
+        if (prefix_sharing && band_width == 0) {
+            for (std::vector<int>& group : prefix_groups(batches, workload)) {
+                if (!restore_group(group)) {
+                    calculate_group(batches, group);
+                    for(int i : group) {
+                        save_batch(i);
+                    }
+                }
+            }
+        } else {
+            for(int i = 0; i < workload->batches; i++) {
+                if (!restore_batch(i)) {
+                    calculate_batch(batches[i], i);
+                    save_batch(i);
                 }
+            }
+        }
+
+        if (show_results) {
+            print_results();
+        }
+    }
+
+    // Compute the pairs of batch i of the workload
+    void calculate_batch(t_batch& batch, int i) {
+        int x = workload->bx[i];
+        int y = workload->by[i];
 
-                result_sw[i * PIPE_DEPTH + j][0] = result_sw_m[i * PIPE_DEPTH + j][0] + result_sw_i[i * PIPE_DEPTH + j][0];
+        t_matrix M(x + 1, vector<posit<NBITS, ES>>(y + 1));
+        t_matrix I(x + 1, vector<posit<NBITS, ES>>(y + 1));
+        t_matrix D(x + 1, vector<posit<NBITS, ES>>(y + 1));
+
+        profile.update(batch);
+
+        // Calculate results
+        for(int j = 0; j < PIPE_DEPTH; j++) {
+            posit<NBITS, ES> leak = calculate_mids(batch, j, x, y, M, I, D);
+
+            posit<NBITS, ES> sum_m = 0.0, sum_i = 0.0;
+            for(int c = 1; c < y + 1; c++) {
+                sum_m += M[x][c];
                 // if(i*PIPE_DEPTH+j == 0) {
-                //     cout << "result_sw = " << hexstring(result_sw_m[i * PIPE_DEPTH + j][0].collect()) <<"+"<< hexstring(result_sw_i[i * PIPE_DEPTH + j][0].collect()) << " --> " << hexstring(result_sw[i * PIPE_DEPTH + j][0].collect()) << endl;
+                //     cout << "+= " << hexstring(M[x][c].collect()) << " --> " << hexstring(sum_m.collect()) << endl;
                 // }
 
-                debug_values.debugValue(result_sw[i * PIPE_DEPTH + j][0], "result[%d][%d]", i, j);
+                sum_i += I[x][c];
+                // if(i*PIPE_DEPTH+j == 0) {
+                //     cout << "+= " << hexstring(I[x][c].collect()) << " --> " << hexstring(sum_i.collect()) << endl;
+                // }
+            }
 
-                if (show_table) {
-                    print_mid_table(batches[i], j, x, y, M, I, D);
-                }
+            posit<NBITS, ES> result = store_result(i * PIPE_DEPTH + j, sum_m, sum_i);
+
+            if (band_width > 0 && (double) leak > 0.0) {
+                double rel_leak = (double) leak / ((double) result + (double) leak);
+                band_leak_max = max(band_leak_max, rel_leak);
+            }
+
+            // if(i*PIPE_DEPTH+j == 0) {
+            //     cout << "result_sw = " << hexstring(sum_m.collect()) <<"+"<< hexstring(sum_i.collect()) << " --> " << hexstring(result.collect()) << endl;
+            // }
+
+            debug_values.debugValue(result, "result[%d][%d]", i, j);
+
+            if (show_table) {
+                print_mid_table(batch, j, x, y, M, I, D);
             }
         }
+    }
 
-        if (show_results) {
-            print_results();
+    // Compute the pairs of a group of batches of the same read, sharing common haplotype prefixes
+    void calculate_group(std::vector<t_batch>& batches, const std::vector<int>& group) {
+        int x = workload->bx[group[0]];
+        int y = workload->by[group[0]];
+
+        profile.update(batches[group[0]]);
+
+        for(int j = 0; j < PIPE_DEPTH; j++) {
+            std::vector<posit<NBITS, ES>> sum_m, sum_i;
+            cells_computed += calculate_prefix_pair(batches, group, j, x, y, profile, sum_m, sum_i);
+            cells_total += (uint64_t) group.size() * x * y;
+
+            for(size_t k = 0; k < group.size(); k++) {
+                store_result(group[k] * PIPE_DEPTH + j, sum_m[k], sum_i[k]);
+            }
+        }
+
+        for(int i : group) {
+            for(int j = 0; j < PIPE_DEPTH; j++) {
+                posit<NBITS, ES> result;
+                result.set_raw_bits(results->posit[i * PIPE_DEPTH + j]);
+                debug_values.debugValue(result, "result[%d][%d]", i, j);
+            }
+        }
+    }
+
+    // Results of batch i from the checkpoint; false if it has to be computed
+    bool restore_batch(int i) {
+        const t_checkpoint_record *r = checkpoint ? checkpoint->find(checkpoint_engine, i) : nullptr;
+        if (r == nullptr) {
+            return false;
+        }
+
+        for(int j = 0; j < PIPE_DEPTH; j++) {
+            int row = i * PIPE_DEPTH + j;
+            results->posit[row] = (uint32_t) r->values[j][0];
+            results->posit_m[row] = (uint32_t) (r->values[j][1] >> 32);
+            results->posit_i[row] = (uint32_t) r->values[j][1];
+
+            posit<NBITS, ES> result;
+            result.set_raw_bits(results->posit[row]);
+            debug_values.debugValue(result, "result[%d][%d]", i, j);
+        }
+        return true;
+    }
+
+    // A group shares its computation, so it is only restored as a whole
+    bool restore_group(const std::vector<int>& group) {
+        for(int i : group) {
+            if (checkpoint == nullptr || checkpoint->find(checkpoint_engine, i) == nullptr) {
+                return false;
+            }
+        }
+        for(int i : group) {
+            restore_batch(i);
         }
+        return true;
     }
 
-    void calculate_mids(t_batch& batch, int pair, int x, int y, t_matrix& M, t_matrix& I, t_matrix& D) {
+    void save_batch(int i) {
+        if (checkpoint == nullptr || checkpoint->find(checkpoint_engine, i) != nullptr) {
+            return;
+        }
+
+        t_checkpoint_record r = checkpoint_record(checkpoint_engine, i);
+        for(int j = 0; j < PIPE_DEPTH; j++) {
+            int row = i * PIPE_DEPTH + j;
+            r.values[j][0] = results->posit[row];
+            r.values[j][1] = ((uint64_t) results->posit_m[row] << 32) | results->posit_i[row];
+        }
+        checkpoint->append(r);
+    }
+
+    // Store the sums of the last row of a pair and its result, which is their sum
+    posit<NBITS, ES> store_result(int row, const posit<NBITS, ES>& sum_m, const posit<NBITS, ES>& sum_i) {
+        posit<NBITS, ES> result = sum_m + sum_i;
+        results->posit_m[row] = to_uint(sum_m);
+        results->posit_i[row] = to_uint(sum_i);
+        results->posit[row] = to_uint(result);
+        return result;
+    }
+
+    // Returns an estimate of the probability mass that flowed out of the band
+    posit<NBITS, ES> calculate_mids(t_batch& batch, int pair, int x, int y, t_matrix& M, t_matrix& I, t_matrix& D) {
 
         t_inits& init = batch.init;
-        std::vector<t_bbase>& read = batch.read;
-        std::vector<t_bbase>& hapl = batch.hapl;
-        std::vector<t_probs>& prob = batch.prob;
+        PackedBases& hapl = batch.hapl;
 
         // Set to zero and intial value in the X direction
         for(int j = 0; j < y + 1; j++) {
@@ -109,42 +249,49 @@ public:
             D[i][0] = 0.0;
         }
 
-        posit<NBITS, ES> distm_simi, distm_diff, alpha, beta, delta, epsilon, zeta, eta, distm;
-        for(int i = 1; i < x + 1; i++) {
-            unsigned char rb = read[i - 1 + pair].base;
-
-            eta.set_raw_bits(prob[(i - 1) + pair].p[0].b);
-            zeta.set_raw_bits(prob[(i - 1) + pair].p[1].b);
-            epsilon.set_raw_bits(prob[(i - 1) + pair].p[2].b);
-            delta.set_raw_bits(prob[(i - 1) + pair].p[3].b);
-            beta.set_raw_bits(prob[(i - 1) + pair].p[4].b);
-            alpha.set_raw_bits(prob[(i - 1) + pair].p[5].b);
-            distm_diff.set_raw_bits(prob[(i - 1) + pair].p[6].b);
-            distm_simi.set_raw_bits(prob[(i - 1) + pair].p[7].b);
+        // One-hot haplotype bases of this pair; with the match codes of a row they select the prior
+        std::vector<uint8_t> hb(y);
+        hapl.unpack_onehot(pair, y, hb.data());
 
-            // if(i == 1 && pair == 0) {
-            //     cout << "eta: " << hexstring(eta.collect()) << endl;
-            //     cout << "zeta: " << hexstring(zeta.collect()) << endl;
-            //     cout << "epsilon: " << hexstring(epsilon.collect()) << endl;
-            //     cout << "delta: " << hexstring(delta.collect()) << endl;
-            //     cout << "beta: " << hexstring(beta.collect()) << endl;
-            //     cout << "alpha: " << hexstring(alpha.collect()) << endl;
-            //     cout << "distm_diff: " << hexstring(distm_diff.collect()) << endl;
-            //     cout << "distm_simi: " << hexstring(distm_simi.collect()) << endl;
-            // }
-
-            for(int j = 1; j < y + 1; j++) {
-                unsigned char hb = hapl[j - 1 + pair].base;
+        // Columns lo ... hi of each row are computed, cells outside the band
+        // are never written and stay zero
+        int lo = 1, hi = y;
+        posit<NBITS, ES> leak = 0.0;
 
-                // if(i == 1 && pair == 0) {
-                //     cout << rb <<" & "<< hb << endl;
-                // }
-
-                if (rb == hb || rb == 'N' || hb == 'N') {
-                    distm = distm_simi;
-                } else {
-                    distm = distm_diff;
+        posit<NBITS, ES> alpha, beta, delta, epsilon, zeta, eta, distm;
+        for(int i = 1; i < x + 1; i++) {
+            // Coefficients of read position (i - 1) + pair, from the profile of the read
+            int pos = (i - 1) + pair;
+            const posit<NBITS, ES> *prior = profile.priors(pos);
+            uint32_t codes = profile.match_codes(pos);
+
+            eta = profile.eta[pos];
+            zeta = profile.zeta[pos];
+            epsilon = profile.epsilon[pos];
+            delta = profile.delta[pos];
+            beta = profile.beta[pos];
+            alpha = profile.alpha[pos];
+
+            if (band_width > 0) {
+                lo = max(1, i + band_offset - band_width);
+                hi = min(y, i + band_offset + band_width);
+
+                // Mass that would have entered, or left, the band in this row
+                if (i == 1) {
+                    for(int j = 1; j < y + 1; j++) {
+                        if (j < lo || j > hi) {
+                            leak += prior[(codes >> hb[j - 1]) & 1] * (beta * D[0][j - 1]);
+                        }
+                    }
+                } else if (lo > 1 && lo <= y + 1) {
+                    leak += delta * M[i - 1][lo - 1] + epsilon * I[i - 1][lo - 1];
                 }
+            }
+            cells_total += y;
+            cells_computed += max(0, hi - lo + 1);
+
+            for(int j = lo; j < hi + 1; j++) {
+                distm = prior[(codes >> hb[j - 1]) & 1];
 
                 M[i][j] = distm * (alpha * M[i - 1][j - 1] + beta * I[i - 1][j - 1] + beta * D[i - 1][j - 1]);
                 I[i][j] = delta * M[i - 1][j] + epsilon * I[i - 1][j];
@@ -170,41 +317,27 @@ public:
                 // }
             }
 
+            if (band_width > 0 && hi >= lo && hi < y) {
+                leak += zeta * M[i][hi] + eta * D[i][hi];
+            }
+
             // if(i == 1 && pair == 0) {
             //     cout << endl;
             // }
         }
-    } // calculate_mids
 
-    int count_errors(std::vector<uint32_t>& batch_offsets, std::vector<uint32_t>& batch_length, std::vector<uint32_t *>& hr) {
-        int total_errors = 0;
-        posit<NBITS, ES> hwp, swp;
-
-        for(int i = 0; i < workload->batches; i++) {
-            int core_index = batchToCore(i, batch_offsets);
-            int core_single_batch = batch_length[core_index] == 1;
-            int core_batch = core_single_batch ? 0 : (batch_length[core_index] - batchToCoreBatch(i, batch_length) - 1);
-
-            for(int j = 0; j < PIPE_DEPTH; j++) {
-                swp = result_sw[i * PIPE_DEPTH + j][0];
-                hwp.set_raw_bits(hr[core_index][core_batch * PIPE_DEPTH + j]);
-
-                posit<NBITS, ES> err = swp / hwp;
-
-                if ((err < ERR_LOWER) || (err > ERR_UPPER)) {
-                    total_errors++;
-                    cout << "SW: " << hexstring(swp.collect()) << ", HW: " << hexstring(hwp.collect()) << endl;
-                }
-            }
-        }
+        return leak;
+    } // calculate_mids
 
-        return total_errors;
-    } // count_errors
+    // Raw bits of the results, in batch order (batch * PIPE_DEPTH + pair)
+    std::vector<uint32_t> result_bits() {
+        return std::vector<uint32_t>(results->posit.begin(), results->posit.begin() + workload->batches * PIPE_DEPTH);
+    } // result_bits
 
     void print_mid_table(t_batch& batch, int pair, int r, int c, t_matrix& M, t_matrix& I, t_matrix& D) {
         int w = c + 1;
-        std::vector<t_bbase>& read = batch.read;
-        std::vector<t_bbase>& hapl = batch.hapl;
+        PackedBases& read = batch.read;
+        PackedBases& hapl = batch.hapl;
 
         posit<NBITS, ES> res[3];
 
@@ -217,7 +350,7 @@ public:
         printf("\n");
         printf("    ║");
         for(uint32_t i = 0; i < c + 1; i++) {
-            printf("      %5d , %c           ║", i, (i > 0) ? (hapl[i - 1 + pair].base) : '-');
+            printf("      %5d , %c           ║", i, (i > 0) ? hapl.at(i - 1 + pair) : '-');
         }
         printf("\n");
         printf("%3d ║", pair);
@@ -238,7 +371,7 @@ public:
 
         // loop over rows
         for(uint32_t j = 0; j < r + 1; j++) {
-            printf("%2d,%c║", j, (j > 0) ? (read[j - 1 + pair].base) : ('-'));
+            printf("%2d,%c║", j, (j > 0) ? read.at(j - 1 + pair) : ('-'));
             // loop over columns
             for(uint32_t i = 0; i < c + 1; i++) {
                 printf("%s %s %s║", hexstring(M[j][i].collect()).c_str(), hexstring(I[j][i].collect()).c_str(), hexstring(D[j][i].collect()).c_str());
@@ -276,14 +409,20 @@ public:
             cout << "║ RESULT FOR BATCH " << i << ":           ║       DECIMAL" << endl;
             cout << "╠═══════════════════════════════╣" << endl;
             for(int j = 0; j < PIPE_DEPTH; j++) {
+                // Result, and the sums of M and I it is made of
+                posit<NBITS, ES> result, sum_m, sum_i;
+                result.set_raw_bits(results->posit[i * PIPE_DEPTH + j]);
+                sum_m.set_raw_bits(results->posit_m[i * PIPE_DEPTH + j]);
+                sum_i.set_raw_bits(results->posit_i[i * PIPE_DEPTH + j]);
+
                 printf("║%2d: ", j);
-                cout << hexstring(result_sw[i * PIPE_DEPTH + j][0].collect());
+                cout << hexstring(result.collect());
                 cout << " ";
-                cout << hexstring(result_sw[i * PIPE_DEPTH + j][1].collect());
+                cout << hexstring(sum_m.collect());
                 cout << " ";
-                cout << hexstring(result_sw[i * PIPE_DEPTH + j][2].collect());
+                cout << hexstring(sum_i.collect());
                 cout << " ║       ";
-                cout << setprecision(10) << result_sw[i * PIPE_DEPTH + j][0];
+                cout << setprecision(10) << result;
                 cout << endl;
             }
             cout << "╚═══════════════════════════════╝" << endl;
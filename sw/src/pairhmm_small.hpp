@@ -0,0 +1,223 @@
+#ifndef PAIRHMM_PAIRHMM_SMALL_HPP
+#define PAIRHMM_PAIRHMM_SMALL_HPP
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <posit/posit>
+
+#include "debug_values.hpp"
+#include "defines.hpp"
+#include "batch.hpp"
+#include "bases.hpp"
+#include "read_profile.hpp"
+#include "small_posit.hpp"
+#include "checkpoint.hpp"
+
+using namespace std;
+using namespace sw::unum;
+
+/**
+ * Host model of the PE array with a narrow posit<N, E> datapath.
+ *
+ * Every operation is rounded to posit<N, E>, in the same order as the
+ * posit<NBITS, ES> engine does, so the results show what a narrower PE would
+ * compute. The initial values and coefficients are the 32-bit posits of the
+ * workload, rounded to the narrow format.
+ *
+ * The 16 pairs of a batch are computed as SIMD lanes: lane p of row i uses
+ * read position i - 1 + p and haplotype position j - 1 + p, so the
+ * coefficients of a row are consecutive, the prior of a cell is picked with
+ * the match bit of its lane, and all arithmetic is table lookups (gathers).
+ * Matrices are stored row by row, with the lanes of a cell next to each
+ * other.
+ */
+template<int N, int E>
+class PairHMMSmallPosit {
+    typedef SmallPosit<N, E> t_posit;
+    typedef typename t_posit::word word;
+
+private:
+    t_workload *workload;
+    std::vector<double> result;
+    Checkpoint *checkpoint = nullptr;
+    int checkpoint_engine = 0;
+
+    // Profile coefficients rounded to posit<N, E>, for profile build number encoded
+    uint64_t encoded = 0;
+    std::vector<word> alpha, beta, delta, epsilon, zeta, eta, prior;
+
+    void encode_profile() {
+        if (encoded == profile.built) {
+            return;
+        }
+
+        const t_posit& P = t_posit::get();
+        size_t n = profile.size();
+        alpha.resize(n);
+        beta.resize(n);
+        delta.resize(n);
+        epsilon.resize(n);
+        zeta.resize(n);
+        eta.resize(n);
+        prior.resize(n * PRIORS);
+
+        for (size_t i = 0; i < n; i++) {
+            alpha[i] = P.encode(profile.alpha[i]);
+            beta[i] = P.encode(profile.beta[i]);
+            delta[i] = P.encode(profile.delta[i]);
+            epsilon[i] = P.encode(profile.epsilon[i]);
+            zeta[i] = P.encode(profile.zeta[i]);
+            eta[i] = P.encode(profile.eta[i]);
+        }
+        for (size_t i = 0; i < n * PRIORS; i++) {
+            prior[i] = P.encode(profile.prior[i]);
+        }
+
+        encoded = profile.built;
+    }
+
+public:
+    DebugValues<double> debug_values;
+
+    // Decoded coefficients of the last read, reused while batches share it
+    ReadProfile<double> profile;
+
+    PairHMMSmallPosit(t_workload *wl) : workload(wl) {
+        result.resize(workload->batches * PIPE_DEPTH, 0.0);
+    }
+
+    // Name of the format, as used in the benchmark and timing files
+    static std::string name() {
+        return "posit" + std::to_string(N) + "_" + std::to_string(E);
+    }
+
+    // Restore the batches that are in the checkpoint instead of computing
+    // them, and append the results of the others to it
+    void set_checkpoint(Checkpoint *c, int engine) {
+        checkpoint = c;
+        checkpoint_engine = engine;
+    }
+
+    void calculate(std::vector<t_batch>& batches) {
+        for (int i = 0; i < workload->batches; i++) {
+            if (!restore_batch(i)) {
+                calculate_batch(batches[i], i);
+                save_batch(i);
+            }
+        }
+    }
+
+    // Results of batch i from the checkpoint; false if it has to be computed
+    bool restore_batch(int i) {
+        const t_checkpoint_record *r = checkpoint ? checkpoint->find(checkpoint_engine, i) : nullptr;
+        if (r == nullptr) {
+            return false;
+        }
+
+        for (int p = 0; p < PIPE_DEPTH; p++) {
+            result[i * PIPE_DEPTH + p] = bits_double(r->values[p][0]);
+            debug_values.debugValue(result[i * PIPE_DEPTH + p], "result[%d][%d]", i, p);
+        }
+        return true;
+    }
+
+    void save_batch(int i) {
+        if (checkpoint == nullptr) {
+            return;
+        }
+
+        t_checkpoint_record r = checkpoint_record(checkpoint_engine, i);
+        for (int p = 0; p < PIPE_DEPTH; p++) {
+            r.values[p][0] = double_bits(result[i * PIPE_DEPTH + p]);
+        }
+        checkpoint->append(r);
+    }
+
+    // Compute the pairs of batch i of the workload
+    void calculate_batch(t_batch& batch, int i) {
+        const t_posit& P = t_posit::get();
+        const int L = PIPE_DEPTH;
+        int x = workload->bx[i];
+        int y = workload->by[i];
+
+        profile.update(batch);
+        encode_profile();
+
+        // One-hot haplotype bases of all lanes; lane p starts at base p
+        std::vector<uint8_t> hb(y + L - 1);
+        batch.hapl.unpack_onehot(0, hb.size(), hb.data());
+
+        // Two rows per matrix, (y + 1) cells of L lanes
+        std::vector<word> M[2], I[2], D[2];
+        for (int r = 0; r < 2; r++) {
+            M[r].assign((y + 1) * L, 0);
+            I[r].assign((y + 1) * L, 0);
+            D[r].assign((y + 1) * L, 0);
+        }
+
+        posit<NBITS, ES> initial;
+        for (int p = 0; p < L; p++) {
+            initial.set_raw_bits(batch.init.initials[p]);
+            word d = P.encode((double) initial);
+            for (int j = 0; j < y + 1; j++) {
+                D[0][j * L + p] = d;
+            }
+        }
+
+        for (int i_row = 1; i_row < x + 1; i_row++) {
+            const word *Mp = M[(i_row - 1) & 1].data(), *Ip = I[(i_row - 1) & 1].data(), *Dp = D[(i_row - 1) & 1].data();
+            word *Mc = M[i_row & 1].data(), *Ic = I[i_row & 1].data(), *Dc = D[i_row & 1].data();
+
+            // Coefficients of lane p are those of read position (i_row - 1) + p
+            const word *al = &alpha[i_row - 1], *be = &beta[i_row - 1], *de = &delta[i_row - 1];
+            const word *ep = &epsilon[i_row - 1], *ze = &zeta[i_row - 1], *et = &eta[i_row - 1];
+            const word *pr = &prior[(i_row - 1) * PRIORS];
+
+            // Haplotype codes that match the read base of each lane
+            uint32_t codes[L];
+            for (int p = 0; p < L; p++) {
+                codes[p] = profile.match_codes(i_row - 1 + p);
+            }
+
+            for (int p = 0; p < L; p++) {
+                Mc[p] = 0;
+                Ic[p] = 0;
+                Dc[p] = 0;
+            }
+
+            for (int j = 1; j < y + 1; j++) {
+                const uint8_t *h = &hb[j - 1];
+
+                #pragma omp simd
+                for (int p = 0; p < L; p++) {
+                    word distm = pr[p * PRIORS + ((codes[p] >> h[p]) & 1)];
+                    int diag = (j - 1) * L + p, up = j * L + p;
+
+                    Mc[up] = P.mul(distm, P.add(P.add(P.mul(al[p], Mp[diag]), P.mul(be[p], Ip[diag])), P.mul(be[p], Dp[diag])));
+                    Ic[up] = P.add(P.mul(de[p], Mp[up]), P.mul(ep[p], Ip[up]));
+                    Dc[up] = P.add(P.mul(ze[p], Mc[diag]), P.mul(et[p], Dc[diag]));
+                }
+            }
+        }
+
+        // Sum the last row, column by column like the accelerator
+        const word *Mx = M[x & 1].data(), *Ix = I[x & 1].data();
+        for (int p = 0; p < L; p++) {
+            word sum_m = 0, sum_i = 0;
+            for (int j = 1; j < y + 1; j++) {
+                sum_m = P.add(sum_m, Mx[j * L + p]);
+                sum_i = P.add(sum_i, Ix[j * L + p]);
+            }
+            result[i * L + p] = P.to_double(P.add(sum_m, sum_i));
+            debug_values.debugValue(result[i * L + p], "result[%d][%d]", i, p);
+        }
+    }
+
+    // Decoded results, in batch order (batch * PIPE_DEPTH + pair)
+    const std::vector<double>& results() const {
+        return result;
+    }
+};
+
+#endif //PAIRHMM_PAIRHMM_SMALL_HPP
@@ -0,0 +1,71 @@
+#include <cmath>
+#include <vector>
+#include <posit/posit>
+
+#include "posit_decode.hpp"
+
+using namespace sw::unum;
+
+void decode_posits(const uint32_t *in, double *out, size_t n) {
+    #pragma omp simd
+    for (size_t i = 0; i < n; i++) {
+        out[i] = decode_posit(in[i]);
+    }
+}
+
+void decode_posits_log10(const uint32_t *in, double *out, size_t n) {
+    decode_posits(in, out, n);
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; i++) {
+        out[i] = std::log10(out[i]);
+    }
+}
+
+static bool same(double a, double b) {
+    return (std::isnan(a) && std::isnan(b)) || a == b;
+}
+
+uint64_t check_posit_decoder(uint32_t stride) {
+    std::vector<uint32_t> patterns = {0x00000000, 0x80000000, 0x00000001, 0xFFFFFFFF, 0x7FFFFFFF, 0x80000001,
+                                      0x40000000, 0xC0000000};
+
+    // Shortest and longest regimes, with all exponent and fraction bits set and cleared
+    for (int run = 1; run < 31; run++) {
+        uint32_t ones = (uint32_t) (((1ULL << run) - 1) << (31 - run));
+        uint32_t zeros = 1U << (30 - run);
+        patterns.push_back(ones);
+        patterns.push_back(ones | ((1U << (30 - run)) - 1));
+        patterns.push_back(zeros);
+        patterns.push_back(zeros | (zeros - 1));
+    }
+
+    for (uint64_t b = 0; b <= 0xFFFFFFFFULL; b += stride) {
+        patterns.push_back((uint32_t) b);
+    }
+
+    size_t n = patterns.size();
+    std::vector<uint32_t> negated(n);
+    for (size_t i = 0; i < n; i++) {
+        negated[i] = -patterns[i];
+    }
+    patterns.insert(patterns.end(), negated.begin(), negated.end());
+
+    std::vector<double> decoded(patterns.size());
+    decode_posits(patterns.data(), decoded.data(), patterns.size());
+
+    uint64_t errors = 0;
+    for (size_t i = 0; i < patterns.size(); i++) {
+        posit<NBITS, ES> p;
+        p.set_raw_bits(patterns[i]);
+        double reference = (patterns[i] == 0x80000000) ? std::numeric_limits<double>::quiet_NaN() : (double) p;
+        if (!same(decoded[i], reference)) {
+            if (errors < 10) {
+                fprintf(stderr, "Posit decoder mismatch for %08X: %.17g, expected %.17g\n", patterns[i], decoded[i], reference);
+            }
+            errors++;
+        }
+    }
+
+    return errors;
+}
@@ -0,0 +1,61 @@
+#ifndef __POSIT_DECODE_H
+#define __POSIT_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits>
+
+#include "defines.hpp"
+
+static_assert(NBITS == 32, "The batch posit decoder only handles 32-bit posits");
+static_assert(ES <= 5, "The scale of a posit<32, ES> must fit in the exponent of a double");
+
+/**
+ * Decode one raw posit<32, ES> to double without branches, so that loops over
+ * it vectorise. The regime length is a count of leading zeros (after
+ * inverting a run of ones). Every posit<32, ES> with ES <= 5 is exactly
+ * representable as a double. NaR decodes to NaN.
+ */
+static inline double decode_posit(uint32_t bits) {
+    uint32_t sign = bits >> 31;
+    uint32_t mask = -sign;
+    uint32_t x = (bits ^ mask) + sign;          // Absolute value (two's complement)
+
+    uint32_t y = x << 1;                        // Regime starts at the top
+    uint32_t r0 = y >> 31;
+    // Zero only for 0 and NaR, which are selected below; the low bit keeps the
+    // count defined for them and does not change it for any other value
+    uint32_t run = __builtin_clz((y ^ -r0) | 1);
+    int32_t k = r0 ? (int32_t) run - 1 : -(int32_t) run;
+
+    // Exponent and fraction follow the regime and its terminating bit
+    uint32_t rem = (uint32_t) ((uint64_t) y << (run + 1));
+    int32_t e = ES > 0 ? (int32_t) (rem >> (32 - ES)) : 0;
+    uint32_t frac = (uint32_t) ((uint64_t) rem << ES);
+
+    int64_t scale = (int64_t) k * (1 << ES) + e;
+    uint64_t d = ((uint64_t) sign << 63) | ((uint64_t) (scale + 1023) << 52) | ((uint64_t) frac << 20);
+
+    double v;
+    memcpy(&v, &d, sizeof(v));
+
+    v = (bits == 0) ? 0.0 : v;
+    v = (bits == 0x80000000) ? std::numeric_limits<double>::quiet_NaN() : v;
+    return v;
+}
+
+// Decode n raw posits to double
+void decode_posits(const uint32_t *in, double *out, size_t n);
+
+// Decode n raw posits to log10 of their value
+void decode_posits_log10(const uint32_t *in, double *out, size_t n);
+
+/**
+ * Compare the decoder with the conversion of the posit library for all
+ * special values, the extremes of every regime length and a strided sample
+ * of all other bit patterns. Returns the number of mismatches.
+ */
+uint64_t check_posit_decoder(uint32_t stride = 65537);
+
+#endif //__POSIT_DECODE_H
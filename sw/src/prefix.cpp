@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <string.h>
+
+#include "prefix.hpp"
+
+std::vector<std::vector<int>> prefix_groups(std::vector<t_batch>& batches, t_workload *workload) {
+    std::vector<std::vector<int>> groups;
+
+    for (int b = 0; b < workload->batches; b++) {
+        bool same = !groups.empty() && batches[b].read_id >= 0 && batches[b].read_id == batches[b - 1].read_id
+                    && workload->bx[b] == workload->bx[b - 1] && workload->by[b] == workload->by[b - 1]
+                    && memcmp(batches[b].init.initials, batches[b - 1].init.initials, sizeof(batches[b].init.initials)) == 0;
+        if (!same) {
+            groups.push_back(std::vector<int>());
+        }
+        groups.back().push_back(b);
+    }
+
+    return groups;
+}
+
+int common_prefix(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    size_t n = std::min(a.size(), b.size());
+    size_t i = 0;
+    while (i < n && a[i] == b[i]) {
+        i++;
+    }
+    return (int) i;
+}
+
+uint64_t calculate_prefix_pair(std::vector<t_batch>& batches, const std::vector<int>& group, int pair, int x, int y,
+                               const ReadProfile<posit<NBITS, ES>>& profile,
+                               std::vector<posit<NBITS, ES>>& sum_m, std::vector<posit<NBITS, ES>>& sum_i) {
+    size_t n = group.size();
+
+    std::vector<std::vector<uint8_t>> hb(n, std::vector<uint8_t>(y));
+    for (size_t k = 0; k < n; k++) {
+        batches[group[k]].hapl.unpack_onehot(pair, y, hb[k].data());
+    }
+
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&hb](int a, int b) {
+        return hb[a] < hb[b];
+    });
+
+    // Column after which the k-th haplotype (in sorted order) differs from the previous one
+    std::vector<int> branch(n, 0);
+    for (size_t k = 1; k < n; k++) {
+        branch[k] = common_prefix(hb[order[k - 1]], hb[order[k]]);
+    }
+
+    // State after the branch columns; a later haplotype that branches at column c
+    // starts from the last haplotype that computed column c, which shares its first c bases
+    std::map<int, t_tiled_pair> cache;
+    uint64_t computed = 0;
+
+    sum_m.resize(n);
+    sum_i.resize(n);
+
+    for (size_t k = 0; k < n; k++) {
+        t_batch& batch = batches[group[order[k]]];
+
+        t_tiled_pair s;
+        if (branch[k] > 0) {
+            s = cache[branch[k]];
+        } else {
+            s.M.assign(x + 1, 0.0);
+            s.I.assign(x + 1, 0.0);
+            s.D.assign(x + 1, 0.0);
+            s.D[0].set_raw_bits(batch.init.initials[pair]);
+            s.sum_m = 0.0;
+            s.sum_i = 0.0;
+        }
+        s.batch = &batch;
+        s.profile = &profile;
+        s.pair = pair;
+        s.x = x;
+        s.y = y;
+
+        // Columns where later haplotypes branch off this one, and the last column
+        std::vector<int> stops(1, y);
+        for (size_t m = k + 1; m < n; m++) {
+            if (branch[m] > branch[k]) {
+                stops.push_back(branch[m]);
+            }
+        }
+        std::sort(stops.begin(), stops.end());
+        stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+
+        int col = branch[k];
+        for (int stop : stops) {
+            t_tile_job job;
+            job.state = &s;
+            job.col_start = col + 1;
+            job.cols = stop - col;
+            run_tile(job);
+            computed += (uint64_t) x * (stop - col);
+            col = stop;
+
+            // The last column is only a branch point for a duplicate haplotype
+            if (stop < y || (k + 1 < n && branch[k + 1] == y)) {
+                cache[stop] = s;
+            }
+        }
+
+        sum_m[order[k]] = s.sum_m;
+        sum_i[order[k]] = s.sum_i;
+    }
+
+    return computed;
+}
@@ -0,0 +1,41 @@
+#ifndef __PREFIX_H
+#define __PREFIX_H
+
+#include <stdint.h>
+#include <vector>
+#include <posit/posit>
+
+#include "defines.hpp"
+#include "batch.hpp"
+#include "read_profile.hpp"
+#include "tiling.hpp"
+
+using namespace sw::unum;
+
+/**
+ * Haplotype prefix sharing. The matrices are filled column by column along
+ * the haplotype, so for one read the columns of a haplotype prefix only
+ * depend on that prefix. When the candidate haplotypes of a read are sorted
+ * lexicographically, each one branches off its predecessor at their longest
+ * common prefix and only the columns after it need to be computed; the
+ * column at a branch point is cached until the haplotypes that start from it
+ * are done. The columns are computed with the tile kernel, in the same order
+ * of operations, so the results are bit-identical to the full computation.
+ */
+
+// Runs of consecutive batches that can share columns: same read, X, Y and initial values
+std::vector<std::vector<int>> prefix_groups(std::vector<t_batch>& batches, t_workload *workload);
+
+// Number of leading bases two one-hot sequences have in common
+int common_prefix(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b);
+
+/**
+ * Compute pair `pair` of every batch of a group. The last-row sums are
+ * returned per batch of the group, in group order; the return value is the
+ * number of cells that were actually computed.
+ */
+uint64_t calculate_prefix_pair(std::vector<t_batch>& batches, const std::vector<int>& group, int pair, int x, int y,
+                               const ReadProfile<posit<NBITS, ES>>& profile,
+                               std::vector<posit<NBITS, ES>>& sum_m, std::vector<posit<NBITS, ES>>& sum_i);
+
+#endif //__PREFIX_H
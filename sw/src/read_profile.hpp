@@ -0,0 +1,191 @@
+#ifndef __READ_PROFILE_H
+#define __READ_PROFILE_H
+
+#include <stdint.h>
+#include <vector>
+#include <posit/posit>
+
+#include "defines.hpp"
+#include "bases.hpp"
+#include "batch.hpp"
+
+using namespace sw::unum;
+
+// One-hot haplotype codes are 4 bits wide, so there are 16 possible codes
+#define ONEHOT_CODES     16
+
+// Priors of a read position, indexed by whether the haplotype base matches
+#define PRIOR_MISMATCH   0
+#define PRIOR_MATCH      1
+#define PRIORS           2
+
+// A posit of the workload as a value of the type T of an engine. Posits of
+// another format convert through double, which holds any 32-bit posit exactly.
+template<class T>
+struct engine_value {
+    static T of(const posit<NBITS, ES>& p) { return (T) p; }
+};
+
+template<size_t nbits, size_t es>
+struct engine_value<posit<nbits, es> > {
+    static posit<nbits, es> of(const posit<NBITS, ES>& p) { return posit<nbits, es>((double) p); }
+};
+
+template<>
+struct engine_value<posit<NBITS, ES> > {
+    static posit<NBITS, ES> of(const posit<NBITS, ES>& p) { return p; }
+};
+
+/**
+ * Everything of a read stream that does not depend on the haplotype: the
+ * decoded transition coefficients and the mismatch and match prior of every
+ * position, and the bit-parallel match profile of its bases.
+ *
+ * The match profile holds, for every one-hot haplotype code, a bitvector
+ * over the read positions with a bit set where that haplotype base matches
+ * the read base (Myers' Peq). An N on either side matches everything. The
+ * kernels select the prior of a cell with the match bit instead of
+ * comparing bases.
+ *
+ * The coefficients are stored decoded but not pre-multiplied: each cell has
+ * to round exactly like the accelerator does, one posit operation at a time.
+ *
+ * A profile is built once and reused by all batches of the same read (the
+ * read_id of the batch), so with read-major batches the per-row decoding of
+ * the kernels drops out of all but the first haplotype of a read.
+ */
+template<class T>
+class ReadProfile {
+public:
+    int read_id = -1;
+    std::vector<T> alpha, beta, delta, epsilon, zeta, eta;
+    std::vector<T> prior;   // prior[pos * PRIORS + PRIOR_MISMATCH or PRIOR_MATCH]
+
+    // eq[code * words + pos / 64] bit pos % 64: haplotype code matches read position pos
+    std::vector<uint64_t> eq;
+    size_t words = 0;
+
+    // Transposed: bit code of codes[pos] is set if haplotype code matches read position pos
+    std::vector<uint16_t> codes;
+
+    uint64_t built = 0, reused = 0;
+
+    size_t size() const { return alpha.size(); }
+
+    // Priors of read position pos, indexed by the match bit
+    const T *priors(size_t pos) const { return &prior[pos * PRIORS]; }
+
+    // Match bitvector of a one-hot haplotype code over the read positions
+    const uint64_t *matches(uint8_t code) const { return &eq[code * words]; }
+
+    static int match_bit(const uint64_t *matches, size_t pos) {
+        return (int) ((matches[pos / 64] >> (pos % 64)) & 1);
+    }
+
+    // Haplotype codes that match read position pos, for kernels that walk the read
+    uint32_t match_codes(size_t pos) const { return codes[pos]; }
+
+    // Make this the profile of the read of a batch; only rebuilt for another read
+    const ReadProfile& update(const t_batch& batch) {
+        if (batch.read_id >= 0 && batch.read_id == read_id && size() == batch.qual.size()) {
+            reused++;
+            return *this;
+        }
+
+        size_t n = batch.qual.size();
+        alpha.resize(n);
+        beta.resize(n);
+        delta.resize(n);
+        epsilon.resize(n);
+        zeta.resize(n);
+        eta.resize(n);
+        prior.resize(n * PRIORS);
+
+        posit<NBITS, ES> p;
+        for (size_t i = 0; i < n; i++) {
+            t_probs probs;
+            expand_probs(batch.qual[i], probs);
+
+            p.set_raw_bits(probs.p[0].b); eta[i] = engine_value<T>::of(p);
+            p.set_raw_bits(probs.p[1].b); zeta[i] = engine_value<T>::of(p);
+            p.set_raw_bits(probs.p[2].b); epsilon[i] = engine_value<T>::of(p);
+            p.set_raw_bits(probs.p[3].b); delta[i] = engine_value<T>::of(p);
+            p.set_raw_bits(probs.p[4].b); beta[i] = engine_value<T>::of(p);
+            p.set_raw_bits(probs.p[5].b); alpha[i] = engine_value<T>::of(p);
+
+            p.set_raw_bits(probs.p[6].b); prior[i * PRIORS + PRIOR_MISMATCH] = engine_value<T>::of(p);
+            p.set_raw_bits(probs.p[7].b); prior[i * PRIORS + PRIOR_MATCH] = engine_value<T>::of(p);
+        }
+
+        build_matches(batch.read, n);
+
+        read_id = batch.read_id;
+        built++;
+        return *this;
+    }
+
+private:
+    void build_matches(const PackedBases& read, size_t n) {
+        words = (n + 63) / 64;
+
+        // One bit plane per base, straight from the 2-bit words: bit i of
+        // plane b is set where read base i is b. Ns are in every plane.
+        std::vector<uint64_t> plane(4 * words, 0);
+        const std::vector<uint64_t>& packed = read.data();
+        for (size_t w = 0; w < packed.size() && w * BASES_PER_WORD < n; w++) {
+            uint64_t lo = packed[w] & 0x5555555555555555ULL;
+            uint64_t hi = (packed[w] >> 1) & 0x5555555555555555ULL;
+            uint64_t is[4] = {~hi & ~lo, ~hi & lo, hi & ~lo, hi & lo};
+            for (int b = 0; b < 4; b++) {
+                uint64_t bits = compact_even(is[b] & 0x5555555555555555ULL);
+                size_t first = w * BASES_PER_WORD;
+                plane[b * words + first / 64] |= bits << (first % 64);
+            }
+        }
+        for (uint32_t pos : read.n_positions()) {
+            if (pos < n) {
+                for (int b = 0; b < 4; b++) {
+                    plane[b * words + pos / 64] |= (uint64_t) 1 << (pos % 64);
+                }
+            }
+        }
+
+        // A haplotype code matches where the read has any of its bases
+        eq.assign(ONEHOT_CODES * words, 0);
+        for (int h = 0; h < ONEHOT_CODES; h++) {
+            for (int b = 0; b < 4; b++) {
+                if (h & (1 << b)) {
+                    for (size_t w = 0; w < words; w++) {
+                        eq[h * words + w] |= plane[b * words + w];
+                    }
+                }
+            }
+        }
+
+        // Padding bits past the end of the read never match
+        if (n % 64 != 0) {
+            for (int h = 0; h < ONEHOT_CODES; h++) {
+                eq[h * words + words - 1] &= ((uint64_t) 1 << (n % 64)) - 1;
+            }
+        }
+
+        codes.assign(n, 0);
+        for (size_t pos = 0; pos < n; pos++) {
+            for (int h = 0; h < ONEHOT_CODES; h++) {
+                codes[pos] |= (uint16_t) (match_bit(matches(h), pos) << h);
+            }
+        }
+    }
+
+    // Gather the even bits of x into the low 32 bits
+    static uint64_t compact_even(uint64_t x) {
+        x = (x | (x >> 1)) & 0x3333333333333333ULL;
+        x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+        x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+        x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+        x = (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+        return x;
+    }
+};
+
+#endif //__READ_PROFILE_H
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "result_arena.hpp"
+#include "log.hpp"
+
+ResultArena::~ResultArena() {
+    for (t_region& r : arena) {
+        munlock(r.base, r.bytes);
+        munmap(r.base, r.bytes);
+    }
+}
+
+ResultArena::t_region ResultArena::map_region(size_t bytes) {
+    t_region r;
+    r.bytes = ((bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+    r.huge = true;
+    r.in_use = false;
+
+    // Explicit huge pages first; these are only available if the administrator reserved them
+    r.base = mmap(NULL, r.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (r.base == MAP_FAILED) {
+        r.huge = false;
+        r.base = mmap(NULL, r.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (r.base == MAP_FAILED) {
+            fprintf(stderr, "ERROR: could not map %zu bytes for accelerator results\n", r.bytes);
+            exit(EXIT_FAILURE);
+        }
+        madvise(r.base, r.bytes, MADV_HUGEPAGE);
+    }
+
+    // Keep the buffers resident while the accelerator writes to them. This
+    // is best effort: without the privilege the pages are simply not locked.
+    mlock(r.base, r.bytes);
+
+    LOG_DEBUG(LOG_MEMORY, "Mapped %zu bytes for accelerator results (%s pages)\n", r.bytes, r.huge ? "huge" : "normal");
+    return r;
+}
+
+uint32_t *ResultArena::acquire(size_t words) {
+    size_t bytes = words * sizeof(uint32_t);
+
+    // Smallest free region that fits
+    t_region *best = NULL;
+    for (t_region& r : arena) {
+        if (!r.in_use && r.bytes >= bytes && (best == NULL || r.bytes < best->bytes)) {
+            best = &r;
+        }
+    }
+
+    if (best == NULL) {
+        arena.push_back(map_region(bytes));
+        best = &arena.back();
+    }
+
+    best->in_use = true;
+    uint32_t *buffer = (uint32_t *) best->base;
+    fill_sentinels(buffer, words);
+    return buffer;
+}
+
+void ResultArena::release(uint32_t *buffer) {
+    for (t_region& r : arena) {
+        if (r.base == buffer) {
+            r.in_use = false;
+            return;
+        }
+    }
+    fprintf(stderr, "ERROR: releasing a result buffer that is not part of the arena\n");
+}
+
+size_t ResultArena::bytes_mapped() const {
+    size_t bytes = 0;
+    for (const t_region& r : arena) {
+        bytes += r.bytes;
+    }
+    return bytes;
+}
+
+size_t ResultArena::huge_regions() const {
+    size_t n = 0;
+    for (const t_region& r : arena) {
+        n += r.huge;
+    }
+    return n;
+}
+
+void fill_sentinels(uint32_t *buffer, size_t words) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    // Regions are page aligned, so the streaming stores are always aligned.
+    // The accelerator overwrites these lines anyway; keep them out of the cache.
+    __m128i sentinel = _mm_set1_epi32((int) RESULT_SENTINEL);
+    for (; i + 4 <= words; i += 4) {
+        _mm_stream_si128((__m128i *) (buffer + i), sentinel);
+    }
+    _mm_sfence();
+#else
+    #pragma omp simd
+    for (size_t k = 0; k < words / 4 * 4; k++) {
+        buffer[k] = RESULT_SENTINEL;
+    }
+    i = words / 4 * 4;
+#endif
+
+    for (; i < words; i++) {
+        buffer[i] = RESULT_SENTINEL;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef __RESULT_ARENA_H
+#define __RESULT_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "defines.hpp"
+
+// Size of a huge page; arena regions are a multiple of this
+#define HUGE_PAGE_SIZE           (2 * 1024 * 1024)
+
+/**
+ * Result buffers for the accelerator. Regions are mapped once (backed by huge
+ * pages where the system has them), locked in memory and recycled across
+ * submissions, so setting up the result buffers of a run only costs the
+ * sentinel reset of the words that run will actually use.
+ */
+class ResultArena {
+public:
+    ResultArena() = default;
+    ~ResultArena();
+
+    ResultArena(const ResultArena&) = delete;
+    ResultArena& operator=(const ResultArena&) = delete;
+
+    // Get a BURST_LENGTH-aligned buffer of at least `words` words, all set to RESULT_SENTINEL
+    uint32_t *acquire(size_t words);
+
+    // Return a buffer obtained with acquire() for reuse
+    void release(uint32_t *buffer);
+
+    size_t regions() const { return arena.size(); }
+    size_t bytes_mapped() const;
+    size_t huge_regions() const;
+
+private:
+    typedef struct struct_region {
+        void *base;
+        size_t bytes;
+        bool huge;      // Mapped with MAP_HUGETLB (otherwise transparent huge pages are requested)
+        bool in_use;
+    } t_region;
+
+    std::vector<t_region> arena;
+
+    t_region map_region(size_t bytes);
+};
+
+// Set `words` words to RESULT_SENTINEL, bypassing the cache where the target supports it
+void fill_sentinels(uint32_t *buffer, size_t words);
+
+#endif //__RESULT_ARENA_H
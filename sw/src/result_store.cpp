@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <string>
+
+// Apache Arrow
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+
+#include "result_store.hpp"
+
+using namespace std;
+
+// Wrap a column in an Arrow array without copying it
+template<class ArrayType, class T>
+static shared_ptr<arrow::Array> wrap_column(const std::vector<T>& column) {
+    auto buffer = make_shared<arrow::Buffer>(reinterpret_cast<const uint8_t *>(column.data()),
+                                             (int64_t) (column.size() * sizeof(T)));
+    return make_shared<ArrayType>((int64_t) column.size(), buffer);
+}
+
+shared_ptr<arrow::Table> ResultStore::table() const {
+    vector<shared_ptr<arrow::Field> > schema_fields = {
+            arrow::field("hw", arrow::uint32(), false),
+            arrow::field("tiled", arrow::uint32(), false),
+            arrow::field("posit", arrow::uint32(), false),
+            arrow::field("posit_m", arrow::uint32(), false),
+            arrow::field("posit_i", arrow::uint32(), false),
+            arrow::field("float", arrow::float32(), false),
+            arrow::field("reference", arrow::float64(), false)
+    };
+
+    // The posit columns are raw bits of this posit configuration
+    const std::vector<std::string> keys = {"posit_nbits", "posit_es"};
+    const std::vector<std::string> values = {std::to_string(NBITS), std::to_string(ES)};
+    auto schema_meta = std::make_shared<arrow::KeyValueMetadata>(keys, values);
+
+    auto schema = std::make_shared<arrow::Schema>(schema_fields, schema_meta);
+
+    return arrow::Table::Make(schema, {
+            wrap_column<arrow::UInt32Array>(hw),
+            wrap_column<arrow::UInt32Array>(tiled),
+            wrap_column<arrow::UInt32Array>(posit),
+            wrap_column<arrow::UInt32Array>(posit_m),
+            wrap_column<arrow::UInt32Array>(posit_i),
+            wrap_column<arrow::FloatArray>(flt),
+            wrap_column<arrow::DoubleArray>(reference)
+    });
+}
+
+bool ResultStore::write(const std::string& filename) const {
+    shared_ptr<arrow::Table> results = table();
+
+    shared_ptr<arrow::io::FileOutputStream> file;
+    shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+    arrow::Status status = arrow::io::FileOutputStream::Open(filename, &file);
+    if (status.ok()) {
+        status = arrow::ipc::RecordBatchFileWriter::Open(file.get(), results->schema(), &writer);
+    }
+    if (status.ok()) {
+        status = writer->WriteTable(*results);
+    }
+    if (status.ok()) {
+        status = writer->Close();
+    }
+    if (file) {
+        file->Close();
+    }
+
+    if (!status.ok()) {
+        fprintf(stderr, "ERROR: could not write results to %s: %s\n", filename.c_str(), status.ToString().c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef __RESULT_STORE_H
+#define __RESULT_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Apache Arrow
+#include <arrow/api.h>
+
+#include "defines.hpp"
+
+/**
+ * Results of all engines, one row per pair in batch order
+ * (batch * PIPE_DEPTH + pair), stored as one flat array per column.
+ *
+ * The engines write their results into the rows of their workload in place;
+ * columns an engine does not compute stay zero. table() exports the columns
+ * as an Arrow table without copying them.
+ */
+class ResultStore {
+public:
+    std::vector<uint32_t> hw;           // Raw posit results of the accelerator
+    std::vector<uint32_t> tiled;        // Raw posit results of the tiled host engine, for pairs longer than the accelerator supports
+    std::vector<uint32_t> posit;        // Raw posit results of the posit engine
+    std::vector<uint32_t> posit_m;      // Its sums of the M and I values of the last row
+    std::vector<uint32_t> posit_i;
+    std::vector<float> flt;             // Float engine
+    std::vector<double> reference;      // Higher-precision float engine, e.g. the 100-digit reference, rounded to double
+
+    ResultStore(size_t pairs = 0) {
+        resize(pairs);
+    }
+
+    void resize(size_t pairs) {
+        hw.resize(pairs, 0);
+        tiled.resize(pairs, 0);
+        posit.resize(pairs, 0);
+        posit_m.resize(pairs, 0);
+        posit_i.resize(pairs, 0);
+        flt.resize(pairs, 0.0f);
+        reference.resize(pairs, 0.0);
+    }
+
+    size_t size() const { return hw.size(); }
+
+    // Column a PairHMMFloat<T> engine writes to; float fills flt, any other type reference
+    template<class T>
+    struct float_column {
+        static std::vector<double>& of(ResultStore& store) { return store.reference; }
+    };
+
+    /**
+     * The columns as an Arrow table. Its buffers point into this store, so the
+     * table is only valid while the store lives and is not resized.
+     */
+    std::shared_ptr<arrow::Table> table() const;
+
+    // Write the table to an Arrow IPC file; false (with a message) on failure
+    bool write(const std::string& filename) const;
+};
+
+template<>
+struct ResultStore::float_column<float> {
+    static std::vector<float>& of(ResultStore& store) { return store.flt; }
+};
+
+#endif //__RESULT_STORE_H
@@ -0,0 +1,76 @@
+#ifndef __RNG_H
+#define __RNG_H
+
+#include <stdint.h>
+
+// Seed of the synthetic workload generator
+#define RNG_SEED         0x9E3779B9
+
+// Independent random streams of the workload generator
+#define RNG_READ_BASES   0
+#define RNG_HAPL_BASES   1
+#define RNG_PROBS        2
+#define RNG_HAPL_VARIANTS 3
+#define RNG_SAMPLE       4
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3", SC'11). Every output block is a pure function
+// of (key, counter), so any element of a workload can be generated
+// independently of all others, in any order and on any thread.
+typedef struct struct_philox {
+    uint32_t v[4];
+} t_philox;
+
+inline void philox_round(uint32_t ctr[4], const uint32_t key[2]) {
+    uint64_t p0 = (uint64_t) 0xD2511F53 * ctr[0];
+    uint64_t p1 = (uint64_t) 0xCD9E8D57 * ctr[2];
+
+    uint32_t hi0 = (uint32_t) (p0 >> 32), lo0 = (uint32_t) p0;
+    uint32_t hi1 = (uint32_t) (p1 >> 32), lo1 = (uint32_t) p1;
+
+    ctr[0] = hi1 ^ ctr[1] ^ key[0];
+    ctr[1] = lo1;
+    ctr[2] = hi0 ^ ctr[3] ^ key[1];
+    ctr[3] = lo0;
+}
+
+inline t_philox philox4x32(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t k0, uint32_t k1) {
+    t_philox out;
+    uint32_t key[2] = {k0, k1};
+
+    out.v[0] = c0; out.v[1] = c1; out.v[2] = c2; out.v[3] = c3;
+    for (int r = 0; r < 10; r++) {
+        philox_round(out.v, key);
+        key[0] += 0x9E3779B9;
+        key[1] += 0xBB67AE85;
+    }
+    return out;
+}
+
+/**
+ * Random draws for one element (e.g. one read position) of one batch.
+ * Draw number d of element i in stream s of batch b always returns the same
+ * value, independent of thread count or generation order.
+ */
+class CounterRNG {
+private:
+    uint32_t key[2];
+    uint32_t element;
+
+public:
+    CounterRNG(uint32_t batch, uint32_t stream, uint32_t element) : element(element) {
+        key[0] = RNG_SEED ^ batch;
+        key[1] = stream;
+    }
+
+    uint32_t bits(uint32_t draw, uint32_t attempt = 0) const {
+        return philox4x32(element, draw, attempt, 0, key[0], key[1]).v[0];
+    }
+
+    // Uniform float in [0, 1]
+    float uniform(uint32_t draw, uint32_t attempt = 0) const {
+        return (float) (bits(draw, attempt) >> 8) / (float) ((1 << 24) - 1);
+    }
+};
+
+#endif //__RNG_H
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <omp.h>
+#include <boost/multiprecision/cpp_dec_float.hpp>
+
+#include "sampling.hpp"
+#include "utils.hpp"
+#include "rng.hpp"
+
+using boost::multiprecision::cpp_dec_float_100;
+
+SampledValidator::SampledValidator(double fraction, double budget)
+        : fraction(fraction), budget(budget) {
+}
+
+int length_class(t_workload *workload, int batch) {
+    return (int) floor(log2(max(1.0, (double) workload->bx[batch] * (double) workload->by[batch])));
+}
+
+static t_stratum_key stratum_of(std::vector<t_batch>& batches, t_workload *workload, int b) {
+    return t_stratum_key(length_class(workload, b), batches[b].init.initials[0]);
+}
+
+static double rel_err(const cpp_dec_float_100& exact, const cpp_dec_float_100& computed) {
+    if (exact == 0) {
+        return computed == 0 ? 0.0 : std::numeric_limits<double>::infinity();
+    }
+    cpp_dec_float_100 err = abs((computed - exact) / exact);
+    return err.convert_to<double>();
+}
+
+void SampledValidator::validate_batch(std::vector<t_batch>& batches, t_workload *workload, const std::vector<uint32_t>& hw,
+                                      int b, t_stratum& stratum) {
+    t_workload *one = select_workload(workload, std::vector<int>(1, b));
+
+    PairHMMPosit posit_engine(one, false, false);
+    PairHMMFloat<float> float_engine(one, false, false);
+    PairHMMFloat<cpp_dec_float_100> dec_engine(one, false, false);
+    posit_engine.calculate_batch(batches[b], 0);
+    float_engine.calculate_batch(batches[b], 0);
+    dec_engine.calculate_batch(batches[b], 0);
+    std::vector<uint32_t> sw = posit_engine.result_bits();
+
+    double m[3] = {0.0, 0.0, 0.0};
+    for (int j = 0; j < PIPE_DEPTH; j++) {
+        uint32_t h = hw[b * PIPE_DEPTH + j];
+        const cpp_dec_float_100& exact = dec_engine.debug_values.items[j].value;
+
+        posit<NBITS, ES> res_hw;
+        res_hw.set_raw_bits(h);
+        double err_hw = rel_err(exact, static_cast<cpp_dec_float_100>(res_hw));
+        m[METRIC_MISMATCH] += (sw[j] != h) ? 1.0 : 0.0;
+        m[METRIC_REL_HW] += err_hw;
+        m[METRIC_REL_FLOAT] += rel_err(exact, float_engine.debug_values.items[j].value);
+        max_rel_err_hw = max(max_rel_err_hw, err_hw);
+    }
+
+    for (int k = 0; k < 3; k++) {
+        m[k] /= PIPE_DEPTH;
+        stratum.sum[k] += m[k];
+        stratum.sum_sq[k] += m[k] * m[k];
+    }
+    stratum.sampled++;
+
+    free_workload(one);
+}
+
+void SampledValidator::validate(std::vector<t_batch>& batches, t_workload *workload, const std::vector<uint32_t>& hw,
+                                double t_compute, int first_batch) {
+    double start = omp_get_wtime();
+    if (budget > 0.0) {
+        t_allowed += budget * t_compute;
+    }
+
+    // Draw the sample, per stratum
+    std::map<t_stratum_key, std::vector<int> > drawn;
+    for (int b = 0; b < workload->batches; b++) {
+        t_stratum_key key = stratum_of(batches, workload, b);
+        strata[key].population++;
+
+        CounterRNG rng(first_batch + b, RNG_SAMPLE, 0);
+        if (fraction >= 1.0 || rng.uniform(0) < fraction) {
+            drawn[key].push_back(b);
+        }
+    }
+
+    // Round-robin over the strata, least covered first, so a budget that runs
+    // out leaves all strata about equally covered
+    std::vector<t_stratum_key> keys;
+    for (auto& d : drawn) {
+        keys.push_back(d.first);
+    }
+    std::stable_sort(keys.begin(), keys.end(), [this](const t_stratum_key& a, const t_stratum_key& b) {
+        return strata[a].sampled < strata[b].sampled;
+    });
+
+    std::vector<std::pair<t_stratum_key, int> > order;
+    for (size_t round = 0; order.size() < (size_t) workload->batches; round++) {
+        bool any = false;
+        for (t_stratum_key& key : keys) {
+            if (round < drawn[key].size()) {
+                order.push_back(std::make_pair(key, drawn[key][round]));
+                any = true;
+            }
+        }
+        if (!any) {
+            break;
+        }
+    }
+
+    for (auto& o : order) {
+        if (budget > 0.0 && t_spent + (omp_get_wtime() - start) >= t_allowed) {
+            break;
+        }
+        validate_batch(batches, workload, hw, o.second, strata[o.first]);
+    }
+
+    t_spent += omp_get_wtime() - start;
+}
+
+t_sample_report SampledValidator::report() const {
+    t_sample_report r;
+    r.population = 0;
+    r.sampled = 0;
+    r.strata = 0;
+    r.strata_sampled = 0;
+    r.t_validate = t_spent;
+    r.t_allowed = t_allowed;
+    r.max_rel_err_hw = max_rel_err_hw;
+
+    // Strata without a validated batch are left out, and the others weighted by their share of the rest
+    uint64_t covered = 0;
+    for (auto& s : strata) {
+        r.population += s.second.population;
+        r.sampled += s.second.sampled;
+        r.strata++;
+        if (s.second.sampled > 0) {
+            r.strata_sampled++;
+            covered += s.second.population;
+        }
+    }
+
+    for (int k = 0; k < 3; k++) {
+        // Pooled variance, for strata with a single validated batch
+        double n = 0.0, sum = 0.0, sum_sq = 0.0;
+        for (auto& s : strata) {
+            n += s.second.sampled;
+            sum += s.second.sum[k];
+            sum_sq += s.second.sum_sq[k];
+        }
+        double pooled = n > 1.0 ? max(0.0, (sum_sq - sum * sum / n) / (n - 1.0)) : 0.0;
+
+        double mean = 0.0, var = 0.0;
+        for (auto& s : strata) {
+            const t_stratum& st = s.second;
+            if (st.sampled == 0) {
+                continue;
+            }
+            double nh = st.sampled;
+            double w = (double) st.population / (double) covered;
+            double s2 = nh > 1.0 ? max(0.0, (st.sum_sq[k] - st.sum[k] * st.sum[k] / nh) / (nh - 1.0)) : pooled;
+
+            mean += w * st.sum[k] / nh;
+            var += w * w * (1.0 - nh / (double) st.population) * s2 / nh;
+        }
+
+        r.metric[k].mean = mean;
+        r.metric[k].half_width = CI_Z * sqrt(var);
+    }
+
+    // Without a single mismatch the interval is empty; use the rule of three for its upper end
+    if (r.metric[METRIC_MISMATCH].mean == 0.0 && r.sampled > 0) {
+        r.metric[METRIC_MISMATCH].half_width = 3.0 / ((double) r.sampled * PIPE_DEPTH);
+    }
+
+    return r;
+}
+
+void print_sample_report(const t_sample_report& report, std::ostream& out) {
+    out << "population,sampled,strata,strata_sampled,t_validate,t_allowed,mismatch_rate,mismatch_rate_ci,"
+        << "rel_err_hw,rel_err_hw_ci,rel_err_float,rel_err_float_ci,max_rel_err_hw" << endl;
+    out << report.population << "," << report.sampled << "," << report.strata << "," << report.strata_sampled << ","
+        << report.t_validate << "," << report.t_allowed;
+    for (int k = 0; k < 3; k++) {
+        out << "," << report.metric[k].mean << "," << report.metric[k].half_width;
+    }
+    out << "," << report.max_rel_err_hw << endl;
+}
@@ -0,0 +1,90 @@
+#ifndef __SAMPLING_H
+#define __SAMPLING_H
+
+#include <stdint.h>
+#include <map>
+#include <utility>
+#include <vector>
+#include <iostream>
+
+#include "defines.hpp"
+#include "batch.hpp"
+
+// Normal quantile of the two-sided 95% confidence intervals
+#define CI_Z             1.959964
+
+// Length class of a batch: log2 of the cells of its longest pair
+int length_class(t_workload *workload, int batch);
+
+// Stratum of a batch: length class and raw initial value
+typedef std::pair<int, uint32_t> t_stratum_key;
+
+// Sums over the validated batches of one stratum; every metric is a batch mean over its pairs
+typedef struct struct_stratum {
+    uint64_t population;        // Batches seen
+    uint64_t sampled;           // Batches validated
+    double sum[3];              // Per metric: sum, and sum of squares, of the batch means
+    double sum_sq[3];
+} t_stratum;
+
+// Metrics of a validated batch
+#define METRIC_MISMATCH  0      // Fraction of results that differ from the posit reference
+#define METRIC_REL_HW    1      // Relative error of the accelerator to the 100-digit reference
+#define METRIC_REL_FLOAT 2      // Relative error of the float engine to the 100-digit reference
+
+typedef struct struct_estimate {
+    double mean;
+    double half_width;          // Of the 95% confidence interval
+} t_estimate;
+
+typedef struct struct_sample_report {
+    uint64_t population;        // Batches seen
+    uint64_t sampled;           // Batches validated
+    int strata;
+    int strata_sampled;
+    double t_validate;          // CPU time spent on validation
+    double t_allowed;           // CPU time allowed by the budget (0 without a budget)
+    t_estimate metric[3];
+    double max_rel_err_hw;
+} t_sample_report;
+
+/**
+ * Validates a stratified random sample of the batches instead of all of them.
+ *
+ * Batches are stratified by length class and initial value, and every batch
+ * is drawn with probability fraction, from its own counter-based random
+ * stream so the sample does not depend on how the input is split into runs.
+ * A drawn batch is computed with the posit, float and 100-digit host engines,
+ * and compared with the accelerator results.
+ *
+ * With a CPU budget, validation may use at most budget seconds of host time
+ * per second of accelerator time, accumulated over all runs; the drawn
+ * batches are validated round-robin over the strata until the budget is used
+ * up, so continuous validation has a fixed overhead.
+ *
+ * The estimates are stratified means with a finite population correction.
+ */
+class SampledValidator {
+public:
+    SampledValidator(double fraction, double budget);
+
+    // Validate a sample of the batches of one run. first_batch is the number of
+    // the first batch in the whole input, t_compute the accelerator time of the run.
+    void validate(std::vector<t_batch>& batches, t_workload *workload, const std::vector<uint32_t>& hw,
+                  double t_compute, int first_batch = 0);
+
+    t_sample_report report() const;
+
+private:
+    double fraction, budget;
+    double t_allowed = 0.0, t_spent = 0.0;
+    double max_rel_err_hw = 0.0;
+    std::map<t_stratum_key, t_stratum> strata;
+
+    void validate_batch(std::vector<t_batch>& batches, t_workload *workload, const std::vector<uint32_t>& hw, int b,
+                        t_stratum& stratum);
+};
+
+void print_sample_report(const t_sample_report& report, std::ostream& out);
+
+#endif //__SAMPLING_H
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+#include "scheduler.hpp"
+#include "utils.hpp"
+#include "log.hpp"
+
+void ShardScheduler::add(std::shared_ptr<Accelerator> accelerator) {
+    accelerators.push_back(accelerator);
+}
+
+double ShardScheduler::batch_cost(t_workload *workload, int batch) {
+    return ::batch_cost(workload, batch);
+}
+
+std::vector<t_shard> ShardScheduler::shard(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload) {
+    std::vector<t_shard> shards(accelerators.size());
+    for (t_shard& s : shards) {
+        s.cost = 0.0;
+    }
+
+    // Consecutive batches of the same read are kept together, so a platform
+    // decodes and stages each read only once
+    std::vector<t_shard> groups;
+    for (int b = 0; b < workload->batches; b++) {
+        int read_id = batches[selection[b]].read_id;
+        if (groups.empty() || read_id < 0 || read_id != batches[selection[b - 1]].read_id) {
+            groups.push_back(t_shard());
+            groups.back().cost = 0.0;
+        }
+        groups.back().batches.push_back(b);
+        groups.back().cost += batch_cost(workload, b);
+    }
+
+    std::stable_sort(groups.begin(), groups.end(), [](const t_shard& a, const t_shard& b) {
+        return a.cost > b.cost;
+    });
+
+    // Give every group to the platform that would finish it first
+    for (t_shard& g : groups) {
+        size_t best = 0;
+        double best_finish = 0.0;
+        for (size_t a = 0; a < accelerators.size(); a++) {
+            double finish = (shards[a].cost + g.cost) / accelerators[a]->throughput();
+            if (a == 0 || finish < best_finish) {
+                best = a;
+                best_finish = finish;
+            }
+        }
+        shards[best].batches.insert(shards[best].batches.end(), g.batches.begin(), g.batches.end());
+        shards[best].cost += g.cost;
+    }
+
+    for (t_shard& s : shards) {
+        std::sort(s.batches.begin(), s.batches.end());
+    }
+
+    return shards;
+}
+
+std::vector<uint32_t> ShardScheduler::run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload) {
+    std::vector<t_shard> shards = shard(batches, selection, workload);
+
+    std::vector<t_workload *> sub_workloads(accelerators.size());
+    std::vector<std::vector<int> > sub_selections(accelerators.size());
+    std::vector<std::vector<uint32_t> > sub_results(accelerators.size());
+
+    // The watchdog counters of the cards are lifetime totals; report only this run's
+    std::vector<int> timeouts_before(accelerators.size()), fallback_before(accelerators.size());
+    for (size_t a = 0; a < accelerators.size(); a++) {
+        timeouts_before[a] = accelerators[a]->timeouts;
+        fallback_before[a] = accelerators[a]->fallback_batches;
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t a = 0; a < accelerators.size(); a++) {
+        if (shards[a].batches.empty()) {
+            continue;
+        }
+
+        sub_workloads[a] = select_workload(workload, shards[a].batches);
+        for (int b : shards[a].batches) {
+            sub_selections[a].push_back(selection[b]);
+        }
+
+        LOG_DEBUG(LOG_SCHED, "%s: %d batches, estimated cost %.0f\n", accelerators[a]->name().c_str(),
+                    (int) shards[a].batches.size(), shards[a].cost);
+
+        // The platforms read the batches of their shard in place
+        threads.push_back(std::thread([this, a, &batches, &sub_selections, &sub_workloads, &sub_results]() {
+            sub_results[a] = accelerators[a]->run(batches, sub_selections[a], sub_workloads[a]);
+        }));
+    }
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    // Merge in the original pair order
+    std::vector<uint32_t> results(workload->batches * PIPE_DEPTH);
+    reports.clear();
+    for (size_t a = 0; a < accelerators.size(); a++) {
+        t_card_report r;
+        r.name = accelerators[a]->name();
+        r.batches = shards[a].batches.size();
+        r.cups = 0;
+        r.mmio_writes = 0;
+        r.timeouts = 0;
+        r.fallback_batches = 0;
+        r.t_fill_table = r.t_prepare_column = r.t_create_core = r.t_run = r.utilization = 0.0;
+        r.model = t_cycle_report();
+        r.model.name = r.name;
+
+        if (!shards[a].batches.empty()) {
+            for (size_t i = 0; i < shards[a].batches.size(); i++) {
+                std::copy(sub_results[a].begin() + i * PIPE_DEPTH, sub_results[a].begin() + (i + 1) * PIPE_DEPTH,
+                          results.begin() + shards[a].batches[i] * PIPE_DEPTH);
+            }
+
+            r.cups = sub_workloads[a]->cups;
+            r.t_fill_table = accelerators[a]->t_fill_table;
+            r.t_prepare_column = accelerators[a]->t_prepare_column;
+            r.t_create_core = accelerators[a]->t_create_core;
+            r.t_run = accelerators[a]->t_run;
+            r.mmio_writes = accelerators[a]->mmio_writes;
+            r.timeouts = accelerators[a]->timeouts - timeouts_before[a];
+            r.fallback_batches = accelerators[a]->fallback_batches - fallback_before[a];
+            r.utilization = ((double) r.cups / r.t_run) / MAX_CUPS_HW;
+
+            r.model = predict_cycles(sub_workloads[a]);
+            r.model.name = r.name;
+            r.model.t_measured = r.t_run;
+            r.model.t_host = r.t_fill_table + r.t_prepare_column + r.t_create_core;
+
+            free_workload(sub_workloads[a]);
+        }
+
+        reports.push_back(r);
+    }
+
+    return results;
+}
+
+void print_card_reports(const std::vector<t_card_report>& reports, std::ostream& out) {
+    out << "card,batches,cups,t_fill_table,t_prepare_column,t_create_core,t_fpga,mmio_writes,timeouts,fallback_batches,utilization" << endl;
+    for (const t_card_report& r : reports) {
+        out << r.name << "," << r.batches << "," << r.cups << "," << r.t_fill_table << "," << r.t_prepare_column << ","
+            << r.t_create_core << "," << r.t_run << "," << r.mmio_writes << "," << r.timeouts << ","
+            << r.fallback_batches << "," << r.utilization << endl;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "batch.hpp"
+#include "accelerator.hpp"
+#include "cycle_model.hpp"
+
+// Batches given to one platform, as indices into its workload, in their original order
+typedef struct struct_shard {
+    std::vector<int> batches;
+    double cost;
+} t_shard;
+
+typedef struct struct_card_report {
+    std::string name;
+    int batches;
+    uint64_t cups;
+    double t_fill_table;
+    double t_prepare_column;
+    double t_create_core;
+    double t_run;
+    uint64_t mmio_writes;
+    int timeouts;           // Watchdog: missed deadlines and batches computed on the host instead
+    int fallback_batches;
+    double utilization;     // Same definition as the overall utilization: (cups / t_run) / MAX_CUPS_HW
+    t_cycle_report model;   // Predicted time of the shard, and where its PE-cycles go
+} t_card_report;
+
+/**
+ * Owns a number of platforms, shards the batches of a workload over them by
+ * estimated cost, runs all platforms concurrently and merges the results back
+ * into the original pair order.
+ */
+class ShardScheduler {
+public:
+    void add(std::shared_ptr<Accelerator> accelerator);
+
+    size_t size() const { return accelerators.size(); }
+
+    // Estimated cost of a batch in PE-cycles, from the cycle model
+    static double batch_cost(t_workload *workload, int batch);
+
+    // Longest-processing-time-first assignment of read groups, weighted by the throughput of each platform
+    std::vector<t_shard> shard(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload);
+
+    /**
+     * Compute the batches selected by index; workload is that of the selection.
+     * Raw posit results in the order of the selection (i * PIPE_DEPTH + pair).
+     */
+    std::vector<uint32_t> run(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload);
+
+    // Reports of the last run, one per platform
+    std::vector<t_card_report> reports;
+
+private:
+    std::vector<std::shared_ptr<Accelerator> > accelerators;
+};
+
+void print_card_reports(const std::vector<t_card_report>& reports, std::ostream& out);
+
+#endif //__SCHEDULER_H
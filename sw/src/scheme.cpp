@@ -5,6 +5,9 @@
 #include <numeric>
 #include <iostream>
 #include <iomanip>
+#include <functional>
+#include <string.h>
+#include <omp.h>
 
 // Apache Arrow
 #include <arrow/api.h>
@@ -14,28 +17,143 @@
 
 using namespace std;
 
+/**
+ * Run fn(begin, end) on consecutive ranges of the batches, one range per
+ * thread. Consecutive batches of the same read mostly end up in one range.
+ */
+static void parallel_ranges(size_t batches, const std::function<void(size_t, size_t)>& fn)
+{
+        #pragma omp parallel
+        {
+                size_t threads = omp_get_num_threads();
+                size_t t = omp_get_thread_num();
+                fn(batches * t / threads, batches * (t + 1) / threads);
+        }
+}
+
+// Fills the values of batches begin ... end, given the offsets (in elements) of all batches
+typedef std::function<void(size_t begin, size_t end, const int32_t* offset, uint8_t* data)> t_fill_range;
+
+// A t_fill_range that fills every batch on its own
+static t_fill_range per_batch(size_t element_bytes, const std::function<void(t_batch&, uint8_t*)>& fill,
+                              std::vector<t_batch>& batches, const std::vector<int>& selection)
+{
+        return [element_bytes, fill, &batches, &selection](size_t begin, size_t end, const int32_t* offset, uint8_t* data) {
+                for (size_t b = begin; b < end; b++) {
+                        fill(batches[selection[b]], data + offset[b] * element_bytes);
+                }
+        };
+}
+
+/**
+ * Buffers of a variable-length column with one value per selected batch: the offsets,
+ * computed up front from the number of elements of every value, and the
+ * values, which are filled in place by all threads at once, each its own
+ * range of batches. The column stays a single chunk, so the platform gets
+ * the same contiguous buffers as before.
+ */
+static void build_values(std::vector<t_batch>& batches, const std::vector<int>& selection, size_t element_bytes,
+                         const std::function<size_t(t_batch&)>& elements, const t_fill_range& fill,
+                         arrow::MemoryPool* pool, shared_ptr<arrow::Buffer>* offsets, shared_ptr<arrow::Buffer>* values)
+{
+        size_t n = selection.size();
+        arrow::AllocateBuffer(pool, (n + 1) * sizeof(int32_t), offsets);
+        int32_t* offset = reinterpret_cast<int32_t*>((*offsets)->mutable_data());
+
+        offset[0] = 0;
+        for (size_t b = 0; b < n; b++) {
+                offset[b + 1] = offset[b] + (int32_t) elements(batches[selection[b]]);
+        }
+
+        arrow::AllocateBuffer(pool, offset[n] * element_bytes, values);
+        uint8_t* data = (*values)->mutable_data();
+
+        parallel_ranges(n, [&](size_t begin, size_t end) {
+                fill(begin, end, offset, data);
+        });
+}
+
+// Binary (or string) column of one value per selected batch
+static shared_ptr<arrow::Array> build_binary(std::vector<t_batch>& batches, const std::vector<int>& selection,
+                                              const shared_ptr<arrow::DataType>& type,
+                                              const std::function<size_t(t_batch&)>& bytes,
+                                              const std::function<void(t_batch&, uint8_t*)>& fill, arrow::MemoryPool* pool)
+{
+        shared_ptr<arrow::Buffer> offsets, values;
+        build_values(batches, selection, 1, bytes, per_batch(1, fill, batches, selection), pool, &offsets, &values);
+        return arrow::MakeArray(arrow::ArrayData::Make(type, selection.size(), { nullptr, offsets, values }, 0));
+}
+
+// Bases as one character per base
+static size_t base_chars(const PackedBases& bases, uint8_t* out)
+{
+        for (size_t i = 0; i < bases.size(); i++) {
+                out[i] = bases.at(i);
+        }
+        return bases.size();
+}
+
+/**
+ * Create the 2-bit packed layout of a base column: one binary value with the
+ * packed bases (4 bases per byte) and one list of N positions per batch.
+ */
+shared_ptr<arrow::Table> create_table_packed(std::vector<t_batch>& batches, const std::vector<int>& selection, const std::string& name,
+                                             PackedBases t_batch::* bases, arrow::MemoryPool* pool)
+{
+        //
+        // listprim(8) with 2-bit bases, listprim(32) of N positions
+        //
+        shared_ptr<arrow::Array> bases_array = build_binary(batches, selection, arrow::binary(),
+                [bases](t_batch& batch) { return (batch.*bases).packed_bytes(); },
+                [bases](t_batch& batch, uint8_t* out) {
+                        memcpy(out, (batch.*bases).packed(), (batch.*bases).packed_bytes());
+                }, pool);
+
+        shared_ptr<arrow::Buffer> n_offsets, n_values;
+        build_values(batches, selection, sizeof(uint32_t),
+                [bases](t_batch& batch) { return (batch.*bases).n_positions().size(); },
+                per_batch(sizeof(uint32_t), [bases](t_batch& batch, uint8_t* out) {
+                        const std::vector<uint32_t>& n_pos = (batch.*bases).n_positions();
+                        memcpy(out, n_pos.data(), n_pos.size() * sizeof(uint32_t));
+                }, batches, selection), pool, &n_offsets, &n_values);
+
+        int64_t n_total = n_values->size() / sizeof(uint32_t);
+        auto n_child = arrow::ArrayData::Make(arrow::uint32(), n_total, { nullptr, n_values }, 0);
+        shared_ptr<arrow::Array> n_array = arrow::MakeArray(
+                arrow::ArrayData::Make(arrow::list(arrow::uint32()), selection.size(), { nullptr, n_offsets }, { n_child }, 0));
+
+        // Define the schema
+        vector<shared_ptr<arrow::Field> > schema_fields = {
+                arrow::field(name, arrow::binary(), false),
+                arrow::field(name + "_n", arrow::list(arrow::uint32()), false)
+        };
+
+        const std::vector<std::string> keys = {"fletcher_mode", "base_encoding"};
+        const std::vector<std::string> values = {"read", "2bit"};
+        auto schema_meta = std::make_shared<arrow::KeyValueMetadata>(keys, values);
+
+        auto schema = std::make_shared<arrow::Schema>(schema_fields, schema_meta);
+
+        // Create and return the table
+        return move(arrow::Table::Make(schema, { bases_array, n_array }));
+}
+
 /**
  * Create an Arrow table containing one column of random bases.
  */
-shared_ptr<arrow::Table> create_table_hapl(std::vector<t_batch>& batches)
+shared_ptr<arrow::Table> create_table_hapl(std::vector<t_batch>& batches, const std::vector<int>& selection, bool packed,
+                                           arrow::MemoryPool* pool)
 {
+        if (packed) {
+                return create_table_packed(batches, selection, "haplotype", &t_batch::hapl, pool);
+        }
+
         //
         // listprim(8)
         //
-        arrow::MemoryPool* pool = arrow::default_memory_pool();
-
-        arrow::StringBuilder hapl_str_builder(pool);
-
-        for(t_batch& batch : batches) {
-            std::vector<t_bbase> haplos = batch.hapl;
-            // char vector to string
-            std::string hapl_string;
-            for(t_bbase base : haplos) {
-                    hapl_string += base.base;
-            }
-            cout << "BUILDING Y: " << hapl_string << endl;
-            hapl_str_builder.Append(hapl_string);
-        }
+        shared_ptr<arrow::Array> hapl_array = build_binary(batches, selection, arrow::utf8(),
+                [](t_batch& batch) { return batch.hapl.size(); },
+                [](t_batch& batch, uint8_t* out) { base_chars(batch.hapl, out); }, pool);
 
         // Define the schema
         vector<shared_ptr<arrow::Field> > schema_fields = { arrow::field("haplotype", arrow::binary(), false) };
@@ -46,33 +164,23 @@ shared_ptr<arrow::Table> create_table_hapl(std::vector<t_batch>& batches)
 
         auto schema = std::make_shared<arrow::Schema>(schema_fields, schema_meta);
 
-        // Create an array and finish the builder
-        shared_ptr<arrow::Array> hapl_array;
-        hapl_str_builder.Finish(&hapl_array);
-
         // Create and return the table
         return move(arrow::Table::Make(schema, { hapl_array }));
 }
 
-shared_ptr<arrow::Table> create_table_reads_reads(std::vector<t_batch>& batches)
+shared_ptr<arrow::Table> create_table_reads_reads(std::vector<t_batch>& batches, const std::vector<int>& selection, bool packed,
+                                                  arrow::MemoryPool* pool)
 {
+        if (packed) {
+                return create_table_packed(batches, selection, "read", &t_batch::read, pool);
+        }
+
         //
         // listprim(8)
         //
-        arrow::MemoryPool* pool = arrow::default_memory_pool();
-
-        arrow::StringBuilder read_str_builder(pool);
-
-        for(t_batch& batch : batches) {
-            std::vector<t_bbase>& reads = batch.read;
-            // char vector to string
-            std::string read_string;
-            for(t_bbase base : reads) {
-                    read_string += base.base;
-            }
-            cout << "BUILDING X: " << read_string << endl;
-            read_str_builder.Append(read_string);
-        }
+        shared_ptr<arrow::Array> read_array = build_binary(batches, selection, arrow::utf8(),
+                [](t_batch& batch) { return batch.read.size(); },
+                [](t_batch& batch, uint8_t* out) { base_chars(batch.read, out); }, pool);
 
         // Define the schema
         vector<shared_ptr<arrow::Field> > schema_fields = { arrow::field("read", arrow::uint8(), false) };
@@ -83,20 +191,16 @@ shared_ptr<arrow::Table> create_table_reads_reads(std::vector<t_batch>& batches)
 
         auto schema = std::make_shared<arrow::Schema>(schema_fields, schema_meta);
 
-        // Create an array and finish the builder
-        shared_ptr<arrow::Array> read_array;
-        read_str_builder.Finish(&read_array);
-
         // Create and return the table
         return move(arrow::Table::Make(schema, { read_array }));
 }
 
-shared_ptr<arrow::Table> create_table_reads_probs(std::vector<t_batch>& batches)
+shared_ptr<arrow::Table> create_table_reads_probs(std::vector<t_batch>& batches, const std::vector<int>& selection,
+                                                  arrow::MemoryPool* pool)
 {
         //
         // listprim(fixed_size_binary(32))
         //
-        arrow::MemoryPool* pool = arrow::default_memory_pool();
 
         // Define the schema
         vector<shared_ptr<arrow::Field> > schema_fields = { arrow::field("probs", arrow::fixed_size_binary(32), false) };
@@ -109,29 +213,36 @@ shared_ptr<arrow::Table> create_table_reads_probs(std::vector<t_batch>& batches)
 
         std::shared_ptr<arrow::DataType> type_ = arrow::fixed_size_binary(32);
 
-        std::unique_ptr<arrow::ArrayBuilder> tmp;
-        arrow::MakeBuilder(pool, type_, &tmp);
-
-        std::unique_ptr<arrow::FixedSizeBinaryBuilder> builder_;
-        builder_.reset(static_cast<arrow::FixedSizeBinaryBuilder*>(tmp.release()));
-
-        for(t_batch& batch : batches) {
-            std::vector<t_probs>& probs = batch.prob;
-
-            for (int i = 0; i < batch.read.size(); ++i) {
-                    t_probs& read_probs = probs[i];
-
-                    // Pack probabilities & append for this read
-                    uint8_t probs_bytes[PROBS_BYTES];
-                    copyProbBytes(read_probs, probs_bytes);
-
-                    builder_->Append(probs_bytes);
-            }
-        }
-
-        // Create an array and finish the builder
-        shared_ptr<arrow::Array> probs_array;
-        builder_->Finish(&probs_array);
+        // Probabilities of every read position of every selected batch, one after the other
+        shared_ptr<arrow::Buffer> offsets, probs;
+        build_values(batches, selection, PROBS_BYTES,
+                [](t_batch& batch) { return batch.read.size(); },
+                [&batches, &selection](size_t begin, size_t end, const int32_t* offset, uint8_t* data) {
+                        for (size_t b = begin; b < end; b++) {
+                                t_batch& batch = batches[selection[b]];
+                                t_batch& previous = batches[selection[b > 0 ? b - 1 : b]];
+                                uint8_t* out = data + offset[b] * PROBS_BYTES;
+
+                                // Read-major batches of the same read copy the probabilities of the previous batch
+                                if (b > begin && batch.read_id >= 0 && batch.read_id == previous.read_id
+                                    && batch.read.size() == previous.read.size()) {
+                                        memcpy(out, data + offset[b - 1] * PROBS_BYTES, batch.read.size() * PROBS_BYTES);
+                                        continue;
+                                }
+
+                                for (size_t i = 0; i < batch.read.size(); ++i) {
+                                        // Expand the qualities only now that they are staged
+                                        t_probs read_probs;
+                                        expand_probs(batch.qual[i], read_probs);
+
+                                        // Pack probabilities for this read
+                                        copyProbBytes(read_probs, out + i * PROBS_BYTES);
+                                }
+                        }
+                }, pool, &offsets, &probs);
+
+        int64_t positions = probs->size() / PROBS_BYTES;
+        shared_ptr<arrow::Array> probs_array = arrow::MakeArray(arrow::ArrayData::Make(type_, positions, { nullptr, probs }, 0));
 
         // Create and return the table
         return move(arrow::Table::Make(schema, { probs_array }));
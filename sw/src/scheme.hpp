@@ -10,6 +10,11 @@
 
 using namespace std;
 
-shared_ptr<arrow::Table> create_table_hapl(std::vector<t_batch>& batches);
-shared_ptr<arrow::Table> create_table_reads_reads(std::vector<t_batch>& batches);
-shared_ptr<arrow::Table> create_table_reads_probs(std::vector<t_batch>& batches);
+// Tables of the batches selected by index, in the order of the selection. The buffers of the tables
+// are allocated from pool; pass an AcceleratorMemoryPool for columns that go to the card
+shared_ptr<arrow::Table> create_table_hapl(std::vector<t_batch>& batches, const std::vector<int>& selection, bool packed = false,
+                                           arrow::MemoryPool* pool = arrow::default_memory_pool());
+shared_ptr<arrow::Table> create_table_reads_reads(std::vector<t_batch>& batches, const std::vector<int>& selection, bool packed = false,
+                                                  arrow::MemoryPool* pool = arrow::default_memory_pool());
+shared_ptr<arrow::Table> create_table_reads_probs(std::vector<t_batch>& batches, const std::vector<int>& selection,
+                                                  arrow::MemoryPool* pool = arrow::default_memory_pool());
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <posit/posit>
+
+#include "defines.hpp"
+#include "small_posit.hpp"
+
+using namespace sw::unum;
+
+// Compare values, products and sums of the tables of posit<N, E> with the posit library
+template<int N, int E>
+static uint64_t check_small_posit(uint32_t stride) {
+    const SmallPosit<N, E>& t = SmallPosit<N, E>::get();
+    uint64_t errors = 0;
+
+    for (uint32_t a = 0; a < (1u << N); a++) {
+        posit<N, E> pa;
+        pa.set_raw_bits(a);
+        double reference = (a == SmallPosit<N, E>::NAR) ? t.value[a] : (double) pa;
+        if (!(t.value[a] == reference || (t.value[a] != t.value[a] && reference != reference))) {
+            if (errors < 10) {
+                fprintf(stderr, "posit<%d, %d> value mismatch for %X: %.9g, expected %.9g\n", N, E, a, t.value[a], reference);
+            }
+            errors++;
+        }
+    }
+
+    for (uint32_t a = 0; a < (1u << N); a += (N == 8) ? 1 : stride) {
+        for (uint32_t b = 0; b < (1u << N); b += (N == 8) ? 1 : stride) {
+            if (a == SmallPosit<N, E>::NAR || b == SmallPosit<N, E>::NAR) {
+                continue;
+            }
+            posit<N, E> pa, pb;
+            pa.set_raw_bits(a);
+            pb.set_raw_bits(b);
+            uint32_t mul = (uint32_t) (pa * pb).collect().to_ulong();
+            uint32_t add = (uint32_t) (pa + pb).collect().to_ulong();
+
+            if (t.mul(a, b) != mul || t.add(a, b) != add) {
+                if (errors < 10) {
+                    fprintf(stderr, "posit<%d, %d> mismatch for %X, %X: product %X, sum %X (expected %X, %X)\n", N, E, a, b,
+                            t.mul(a, b), t.add(a, b), mul, add);
+                }
+                errors++;
+            }
+        }
+    }
+
+    return errors;
+}
+
+uint64_t check_small_posits(uint32_t stride) {
+    return check_small_posit<16, P16_ES>(stride) + check_small_posit<8, P8_ES>(stride);
+}
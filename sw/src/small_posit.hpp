@@ -0,0 +1,180 @@
+#ifndef __SMALL_POSIT_H
+#define __SMALL_POSIT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Software model of a narrow posit<N, E> datapath (N = 8 or 16), to explore
+ * cheaper PEs without synthesizing them. Posits are raw words; arithmetic
+ * is table-driven:
+ *
+ *  - decoding is a lookup of the value (exact in float for N <= 16)
+ *  - encoding looks up the regime and exponent bits of the scale and rounds
+ *    the fraction to nearest even in the encoded bit pattern, which is how
+ *    posits round; values never round to zero or NaR
+ *  - posit<8, E> add and multiply are full 256 x 256 result tables
+ *  - posit<16, E> operands are decoded, multiplied or added in double and
+ *    re-encoded. A product fits a double exactly; a sum either fits or the
+ *    part that does not is far below the rounding bit, so every operation is
+ *    correctly rounded.
+ */
+template<int N, int E>
+class SmallPosit {
+    static_assert(N == 8 || N == 16, "Only 8 and 16-bit posits are modelled");
+    static_assert(E >= 0 && E <= 3, "The exponent size of a small posit must be 0 ... 3");
+
+public:
+    typedef typename std::conditional<N == 8, uint8_t, uint16_t>::type word;
+
+    static const uint32_t MASK = (1u << N) - 1;
+    static const uint32_t NAR = 1u << (N - 1);
+    static const uint32_t MAXPOS = (1u << (N - 1)) - 1;
+    static const int SCALE_MAX = (N - 2) << E;  // Scale of maxpos
+
+    // Tables are built on first use
+    static const SmallPosit& get() {
+        static const SmallPosit tables;
+        return tables;
+    }
+
+    float value[1 << N];                        // Decoded value of every word; NaR is NaN
+    uint32_t prefix[2 * SCALE_MAX];             // Regime and exponent bits of scale - SCALE_MAX
+    int prefix_len[2 * SCALE_MAX];
+    std::vector<word> mul_table, add_table;     // posit<8, E> only, indexed by (a << 8) | b
+
+    double to_double(word p) const {
+        return value[p];
+    }
+
+    word encode(double v) const {
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        uint32_t sign = (uint32_t) (bits >> 63);
+        int scale = (int) ((bits >> 52) & 0x7FF) - 1023;
+        uint64_t frac = bits & ((1ull << 52) - 1);
+
+        uint32_t p;
+        if (scale >= SCALE_MAX) {
+            p = MAXPOS;
+        } else if (scale < -SCALE_MAX) {
+            p = 1;                              // minpos (also for subnormal doubles)
+        } else {
+            // Prefix, then the top 40 fraction bits; the others only count as sticky bits
+            int idx = scale + SCALE_MAX;
+            uint64_t u = ((uint64_t) prefix[idx] << 40) | (frac >> 12);
+            int shift = prefix_len[idx] + 40 - (N - 1);
+
+            uint64_t kept = u >> shift;
+            uint64_t guard = (u >> (shift - 1)) & 1;
+            uint64_t sticky = ((u & ((1ull << (shift - 1)) - 1)) != 0) | ((frac & 0xFFF) != 0);
+            p = (uint32_t) (kept + (guard & (sticky | (kept & 1))));
+        }
+
+        p = sign ? (-p) & MASK : p;
+        p = (v == 0.0) ? 0 : p;
+        p = (v != v || v == std::numeric_limits<double>::infinity() || v == -std::numeric_limits<double>::infinity()) ? NAR : p;
+        return (word) p;
+    }
+
+    word mul(word a, word b) const {
+        if (N == 8) {
+            return mul_table[((uint32_t) a << 8) | b];
+        }
+        return encode((double) value[a] * (double) value[b]);
+    }
+
+    word add(word a, word b) const {
+        if (N == 8) {
+            return add_table[((uint32_t) a << 8) | b];
+        }
+        return encode((double) value[a] + (double) value[b]);
+    }
+
+    // Reference decoder, bit by bit, used to build the value table
+    static double decode(uint32_t p) {
+        p &= MASK;
+        if (p == 0) {
+            return 0.0;
+        }
+        if (p == NAR) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        bool neg = (p >> (N - 1)) != 0;
+        if (neg) {
+            p = (-p) & MASK;
+        }
+
+        int i = N - 2;
+        uint32_t r = (p >> i) & 1;
+        int run = 0;
+        while (i >= 0 && ((p >> i) & 1) == r) {
+            run++;
+            i--;
+        }
+        int k = r ? run - 1 : -run;
+        i--;                                    // Terminating bit of the regime
+
+        int e = 0;
+        for (int b = 0; b < E; b++) {
+            e <<= 1;
+            if (i >= 0) {
+                e |= (p >> i) & 1;
+                i--;
+            }
+        }
+
+        int fbits = i + 1 > 0 ? i + 1 : 0;
+        uint32_t f = p & ((1u << fbits) - 1);
+        double v = ldexp(1.0 + (double) f / (double) (1u << fbits), k * (1 << E) + e);
+        return neg ? -v : v;
+    }
+
+private:
+    SmallPosit() {
+        for (uint32_t p = 0; p < (1u << N); p++) {
+            value[p] = (float) decode(p);
+        }
+
+        for (int s = -SCALE_MAX; s < SCALE_MAX; s++) {
+            int k = s >> E;                     // Arithmetic shift: floor(s / 2^E)
+            uint32_t e = (uint32_t) (s - (k << E));
+            uint32_t regime;
+            int len;
+            if (k >= 0) {
+                regime = ((1u << (k + 1)) - 1) << 1;
+                len = k + 2;
+            } else {
+                regime = 1;
+                len = -k + 1;
+            }
+            prefix[s + SCALE_MAX] = (regime << E) | e;
+            prefix_len[s + SCALE_MAX] = len + E;
+        }
+
+        if (N == 8) {
+            mul_table.resize(1 << 16);
+            add_table.resize(1 << 16);
+            for (uint32_t a = 0; a < 256; a++) {
+                for (uint32_t b = 0; b < 256; b++) {
+                    mul_table[(a << 8) | b] = encode((double) value[a] * (double) value[b]);
+                    add_table[(a << 8) | b] = encode((double) value[a] + (double) value[b]);
+                }
+            }
+        }
+    }
+};
+
+/**
+ * Compare the tables of posit<16, P16_ES> and posit<8, P8_ES> with the posit
+ * library: every value, all posit<8> products and sums, and a strided sample
+ * of posit<16> products and sums. Returns the number of mismatches.
+ */
+uint64_t check_small_posits(uint32_t stride = 257);
+
+#endif //__SMALL_POSIT_H
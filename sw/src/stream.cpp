@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <omp.h>
+
+#include "stream.hpp"
+#include "utils.hpp"
+
+t_stream_report run_stream(unsigned long pairs, unsigned long x, unsigned long y, float initial,
+                           int haplotypes_per_read, int hapl_variants, int window_batches, int queue_depth,
+                           t_batch_executor executor, bool verify, t_verify_summary& summary,
+                           SampledValidator *sampler) {
+    t_stream_report report;
+    report.windows = 0;
+    report.pairs = 0;
+    report.cups = 0;
+    report.t_produce = 0.0;
+    report.t_compute = 0.0;
+    report.t_verify = 0.0;
+
+    summary = empty_verify_summary();
+
+    int total_batches = pairs / PIPE_DEPTH;
+    BoundedQueue<std::unique_ptr<t_window> > queue(queue_depth);
+
+    double start = omp_get_wtime();
+
+    std::thread producer([&]() {
+        for (int first = 0; first < total_batches; first += window_batches) {
+            double t0 = omp_get_wtime();
+
+            std::unique_ptr<t_window> window(new t_window);
+            int n = std::min(window_batches, total_batches - first);
+            window->first = first;
+            window->workload = gen_workload(n * PIPE_DEPTH, x, y);
+            window->batches.resize(n);
+
+            // Batches are numbered as in the whole input, so the data does not depend on the window size
+            #pragma omp parallel for schedule(dynamic)
+            for (int q = 0; q < n; q++) {
+                fill_batch(window->batches[q], first + q, window->workload->bx[q], window->workload->by[q], initial,
+                           read_major_id(first + q, haplotypes_per_read), hapl_variants);
+            }
+
+            report.t_produce += omp_get_wtime() - t0;
+            queue.push(std::move(window));
+        }
+        queue.close();
+    });
+
+    std::unique_ptr<t_window> window;
+    while (queue.pop(window)) {
+        double t0 = omp_get_wtime();
+        std::vector<uint32_t> hw = executor(window->batches, all_batches(window->workload), window->workload);
+        double t1 = omp_get_wtime();
+        report.t_compute += t1 - t0;
+
+        if (sampler != nullptr) {
+            sampler->validate(window->batches, window->workload, hw, t1 - t0, window->first);
+            report.t_verify += omp_get_wtime() - t1;
+        } else if (verify) {
+            PairHMMPosit reference(window->workload, false, false);
+            reference.calculate(window->batches);
+            std::vector<uint32_t> sw = reference.result_bits();
+
+            t_verify_summary part = verify_results(sw.data(), hw.data(), hw.size());
+            merge_verify_summary(summary, part, window->first);
+            report.t_verify += omp_get_wtime() - t1;
+        }
+
+        report.windows++;
+        report.pairs += window->workload->pairs;
+        report.cups += window->workload->cups;
+
+        // Release the window before the next one is taken
+        free_workload(window->workload);
+        window.reset();
+    }
+
+    producer.join();
+
+    report.max_queued = queue.max_size;
+    report.t_total = omp_get_wtime() - start;
+    return report;
+}
+
+void print_stream_report(const t_stream_report& report, std::ostream& out) {
+    out << "windows,pairs,cups,max_queued,t_produce,t_compute,t_verify,t_stream,p_stream" << endl;
+    out << report.windows << "," << report.pairs << "," << report.cups << "," << report.max_queued << ","
+        << report.t_produce << "," << report.t_compute << "," << report.t_verify << "," << report.t_total << ","
+        << ((double) report.cups / report.t_compute) / 1000000 << endl;
+}
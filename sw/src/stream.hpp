@@ -0,0 +1,108 @@
+#ifndef __STREAM_H
+#define __STREAM_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "batch.hpp"
+#include "verify.hpp"
+#include "sampling.hpp"
+
+// Default number of batches per window; large enough to keep a card busy
+#define STREAM_WINDOW_BATCHES    1024
+
+// Default number of windows that may be generated ahead of the one being computed
+#define STREAM_QUEUE_DEPTH       2
+
+// Computes the batches selected by index, e.g. all batches of one window; the workload is that of
+// the selection. Raw posit results in the order of the selection
+typedef std::function<std::vector<uint32_t>(std::vector<t_batch>&, const std::vector<int>&, t_workload *)> t_batch_executor;
+
+// A bounded window of consecutive batches of the input
+typedef struct struct_window {
+    int first;                      // Index of the first batch in the whole input
+    t_workload *workload;
+    std::vector<t_batch> batches;
+} t_window;
+
+typedef struct struct_stream_report {
+    int windows;
+    uint64_t pairs;
+    uint64_t cups;
+    size_t max_queued;              // Largest number of windows waiting to be computed
+    double t_produce;               // Time spent generating windows (producer thread)
+    double t_compute;               // Time spent computing windows
+    double t_verify;                // Time spent on the host reference, or the sample, of each window
+    double t_total;
+} t_stream_report;
+
+/**
+ * Blocking queue with a fixed capacity. push() waits while the queue is full,
+ * pop() waits while it is empty and returns false once the queue is closed
+ * and drained.
+ */
+template<class T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> guard(lock);
+        not_full.wait(guard, [this]() { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        max_size = std::max(max_size, items.size());
+        not_empty.notify_one();
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> guard(lock);
+        not_empty.wait(guard, [this]() { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+        not_empty.notify_all();
+    }
+
+    size_t max_size = 0;
+
+private:
+    size_t capacity;
+    bool closed = false;
+    std::deque<T> items;
+    std::mutex lock;
+    std::condition_variable not_empty, not_full;
+};
+
+/**
+ * Generate, compute and release the input as a sequence of windows of at most
+ * window_batches batches. A producer thread generates windows while the
+ * previous ones are computed, at most queue_depth ahead, so memory use does
+ * not depend on the size of the input. If verify is set, every window is also
+ * computed with the posit reference and the results are compared; with a
+ * sampler, only its sample of every window is validated instead. Batches
+ * are formed read-major with haplotypes_per_read batches per read, with
+ * hapl_variants substituted bases per candidate haplotype.
+ */
+t_stream_report run_stream(unsigned long pairs, unsigned long x, unsigned long y, float initial,
+                           int haplotypes_per_read, int hapl_variants, int window_batches, int queue_depth,
+                           t_batch_executor executor, bool verify, t_verify_summary& summary,
+                           SampledValidator *sampler = nullptr);
+
+void print_stream_report(const t_stream_report& report, std::ostream& out);
+
+#endif //__STREAM_H
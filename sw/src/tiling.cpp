@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <omp.h>
+
+#include "tiling.hpp"
+#include "utils.hpp"
+
+void HostTileExecutor::run(std::vector<t_tile_job>& jobs) {
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t k = 0; k < jobs.size(); k++) {
+        run_tile(jobs[k]);
+    }
+}
+
+void run_tile(t_tile_job& job) {
+    t_tiled_pair& s = *job.state;
+    t_batch& batch = *s.batch;
+    int x = s.x;
+
+    posit<NBITS, ES> initial;
+    initial.set_raw_bits(batch.init.initials[s.pair]);
+
+    // Row coefficients of this pair: positions (i - 1) + pair of the read profile
+    const ReadProfile<posit<NBITS, ES>>& r = *s.profile;
+    int p0 = s.pair - 1;
+
+    std::vector<uint8_t> hb(job.cols);
+    batch.hapl.unpack_onehot(job.col_start - 1 + s.pair, job.cols, hb.data());
+
+    // Previous column (the boundary) in s.M/I/D, current column in M/I/D
+    std::vector<posit<NBITS, ES>> M(x + 1), I(x + 1), D(x + 1);
+    posit<NBITS, ES> distm;
+
+    for (int c = 0; c < job.cols; c++) {
+        M[0] = 0.0;
+        I[0] = 0.0;
+        D[0] = initial;
+
+        // Read positions that match the haplotype base of this column
+        const uint64_t *eq = r.matches(hb[c]);
+
+        // Same operations, in the same order, as PairHMMPosit::calculate_mids
+        for (int i = 1; i < x + 1; i++) {
+            int pos = p0 + i;
+            distm = r.priors(pos)[ReadProfile<posit<NBITS, ES>>::match_bit(eq, pos)];
+
+            M[i] = distm * (r.alpha[pos] * s.M[i - 1] + r.beta[pos] * s.I[i - 1] + r.beta[pos] * s.D[i - 1]);
+            I[i] = r.delta[pos] * M[i - 1] + r.epsilon[pos] * I[i - 1];
+            D[i] = r.zeta[pos] * s.M[i] + r.eta[pos] * s.D[i];
+        }
+
+        s.sum_m += M[x];
+        s.sum_i += I[x];
+
+        s.M.swap(M);
+        s.I.swap(I);
+        s.D.swap(D);
+    }
+}
+
+std::vector<std::pair<int, int>> split_tiles(int y, int tile_cols) {
+    std::vector<std::pair<int, int>> tiles;
+    for (int start = 1; start < y + 1; start += tile_cols) {
+        tiles.push_back(std::make_pair(start, min(tile_cols, y + 1 - start)));
+    }
+    return tiles;
+}
+
+std::vector<uint32_t> calculate_tiled(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload,
+                                      TileExecutor& executor, int tile_cols) {
+    std::vector<uint32_t> results(workload->batches * PIPE_DEPTH);
+
+    // Shared by all pairs and tiles of a batch, and by the next batches of the same read
+    ReadProfile<posit<NBITS, ES>> profile;
+
+    for (int b = 0; b < workload->batches; b++) {
+        int x = workload->bx[b];
+        int y = workload->by[b];
+        t_batch& batch = batches[selection[b]];
+
+        profile.update(batch);
+
+        // Left boundary of the first tile: column 0 of the matrices
+        std::vector<t_tiled_pair> pairs(PIPE_DEPTH);
+        for (int p = 0; p < PIPE_DEPTH; p++) {
+            t_tiled_pair& s = pairs[p];
+            s.batch = &batch;
+            s.profile = &profile;
+            s.pair = p;
+            s.x = x;
+            s.y = y;
+            s.M.assign(x + 1, 0.0);
+            s.I.assign(x + 1, 0.0);
+            s.D.assign(x + 1, 0.0);
+            s.D[0].set_raw_bits(batch.init.initials[p]);
+            s.sum_m = 0.0;
+            s.sum_i = 0.0;
+        }
+
+        for (std::pair<int, int>& tile : split_tiles(y, tile_cols)) {
+            std::vector<t_tile_job> jobs(PIPE_DEPTH);
+            for (int p = 0; p < PIPE_DEPTH; p++) {
+                jobs[p].state = &pairs[p];
+                jobs[p].col_start = tile.first;
+                jobs[p].cols = tile.second;
+            }
+            executor.run(jobs);
+        }
+
+        // Reassemble the likelihood
+        for (int p = 0; p < PIPE_DEPTH; p++) {
+            results[b * PIPE_DEPTH + p] = to_uint(pairs[p].sum_m + pairs[p].sum_i);
+        }
+    }
+
+    return results;
+}
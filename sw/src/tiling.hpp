@@ -0,0 +1,74 @@
+#ifndef __TILING_H
+#define __TILING_H
+
+#include <stdint.h>
+#include <vector>
+#include <posit/posit>
+
+#include "defines.hpp"
+#include "batch.hpp"
+#include "read_profile.hpp"
+
+using namespace std;
+using namespace sw::unum;
+
+// Haplotype columns per tile; a tile fits in a single accelerator job
+#define TILE_COLS        MAX_BP_STRING
+
+/**
+ * State of one pair that is computed in haplotype-column tiles. The boundary
+ * column (M, I and D of rows 0 ... x of the last column of the previous tile)
+ * and the running sums of the last row are all that is carried from one tile
+ * to the next, so the result is bit-identical to an untiled computation.
+ */
+typedef struct struct_tiled_pair {
+    t_batch *batch;
+    const ReadProfile<posit<NBITS, ES>> *profile;     // Decoded coefficients of the read of the batch
+    int pair;
+    int x, y;
+    std::vector<posit<NBITS, ES>> M, I, D;
+    posit<NBITS, ES> sum_m, sum_i;
+} t_tiled_pair;
+
+// One tile of one pair: haplotype columns col_start ... col_start + cols - 1 (1-based)
+typedef struct struct_tile_job {
+    t_tiled_pair *state;
+    int col_start;
+    int cols;
+} t_tile_job;
+
+/**
+ * Executes the jobs of one tile step. Jobs of different pairs are independent;
+ * consecutive tiles of the same pair are submitted in order.
+ *
+ * The current bitstream only takes a constant top row (the initial value
+ * registers) and only returns the last-row sums, so it cannot consume or
+ * produce a boundary column. Until it does, tiles run on the host.
+ */
+class TileExecutor {
+public:
+    virtual ~TileExecutor() = default;
+
+    virtual void run(std::vector<t_tile_job>& jobs) = 0;
+};
+
+class HostTileExecutor : public TileExecutor {
+public:
+    void run(std::vector<t_tile_job>& jobs) override;
+};
+
+// Compute one tile of a pair in posit arithmetic, column by column
+void run_tile(t_tile_job& job);
+
+// Split Y haplotype columns into tiles of at most tile_cols columns
+std::vector<std::pair<int, int>> split_tiles(int y, int tile_cols);
+
+/**
+ * Compute all pairs of the batches selected by index tile by tile and
+ * reassemble the likelihoods; workload is that of the selection. Returns the
+ * raw posit results in the order of the selection.
+ */
+std::vector<uint32_t> calculate_tiled(std::vector<t_batch>& batches, const std::vector<int>& selection, t_workload *workload,
+                                      TileExecutor& executor, int tile_cols = TILE_COLS);
+
+#endif //__TILING_H
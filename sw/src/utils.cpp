@@ -8,6 +8,7 @@
 #include <iostream>
 #include <cmath>
 #include <cfloat>
+#include <algorithm>
 
 #include <posit/posit>
 #include <boost/range/combine.hpp>
@@ -16,6 +17,8 @@
 #include "defines.hpp"
 #include "batch.hpp"
 #include "utils.hpp"
+#include "rng.hpp"
+#include "log.hpp"
 
 using namespace std;
 using namespace sw::unum;
@@ -40,7 +43,8 @@ cpp_dec_float_100 decimal_accuracy(cpp_dec_float_100 exact, cpp_dec_float_100 co
 
 void writeBenchmark(PairHMMFloat<cpp_dec_float_100> &pairhmm_dec50, PairHMMFloat<float> &pairhmm_float,
                     PairHMMPosit &pairhmm_posit, DebugValues<posit<NBITS, ES> > &hw_debug_values, std::string filename,
-                    bool printDate, bool overwrite) {
+                    bool printDate, bool overwrite, const std::vector<std::pair<std::string, DebugValues<double> *> >& extra,
+                    const std::string& hw_name) {
         time_t t = chrono::system_clock::to_time_t(chrono::system_clock::now());
 
         ofstream outfile(filename, ios::out);
@@ -52,8 +56,17 @@ void writeBenchmark(PairHMMFloat<cpp_dec_float_100> &pairhmm_dec50, PairHMMFloat
         auto posit_values = pairhmm_posit.debug_values.items;
         auto hw_values = hw_debug_values.items;
 
-        outfile << "name,dE_f,dE_p,dE_hw,log(abs(dE_f)),log(abs(dE_p)),log(abs(dE_hw)),E,E_f,E_p,E_hw,da_F,da_P,da_HW"
-                << endl;
+        // The results under test are those of the accelerator, or of another engine named by hw_name
+        std::string hw_upper = hw_name;
+        std::transform(hw_upper.begin(), hw_upper.end(), hw_upper.begin(), ::toupper);
+
+        // Engines without a fixed column, e.g. the narrow posit engines, are appended per engine
+        outfile << "name,dE_f,dE_p,dE_" << hw_name << ",log(abs(dE_f)),log(abs(dE_p)),log(abs(dE_" << hw_name << ")),E,E_f,E_p,E_" << hw_name
+                << ",da_F,da_P,da_" << hw_upper;
+        for (auto& engine : extra) {
+                outfile << ",dE_" << engine.first << ",log(abs(dE_" << engine.first << ")),E_" << engine.first << ",da_" << engine.first;
+        }
+        outfile << endl;
         for (int i = 0; i < dec_values.size(); i++) {
                 cpp_dec_float_100 E, E_f, E_p, E_hw, dE_f, dE_p, dE_hw;
                 cpp_dec_float_100 da_F, da_P, da_HW; // decimal accuracies
@@ -71,7 +84,7 @@ void writeBenchmark(PairHMMFloat<cpp_dec_float_100> &pairhmm_dec50, PairHMMFloat
                 E_hw = E_hw_entry->value;
 
                 if (name != E_f_entry->name || name != E_p_entry->name || name != E_hw_entry->name) {
-                        cout << "Error: mismatching names! Could not find name '" << E_f_entry->name << endl;
+                        LOG_ERROR(LOG_VERIFY, "Error: mismatching names! Could not find name '%s'\n", E_f_entry->name.c_str());
                 }
 
                 da_F = decimal_accuracy(E, E_f);
@@ -93,13 +106,27 @@ void writeBenchmark(PairHMMFloat<cpp_dec_float_100> &pairhmm_dec50, PairHMMFloat
                 outfile << setprecision(100) << fixed << dE_f << "," << dE_p << "," << dE_hw << "," << flush;
                 outfile << setprecision(100) << fixed << log10(abs(dE_f)) << "," << log10(abs(dE_p)) << "," << log10(abs(dE_hw)) << "," << flush;
                 outfile << setprecision(100) << fixed << E << "," << E_f << "," << E_p << "," << E_hw << "," << flush;
-                outfile << setprecision(100) << fixed << da_F << "," << da_P << "," << da_HW << endl << flush;
+                outfile << setprecision(100) << fixed << da_F << "," << da_P << "," << da_HW << flush;
+
+                for (auto& engine : extra) {
+                        auto E_x_entry = std::find_if(engine.second->items.begin(), engine.second->items.end(), find_entry(name));
+                        if (E_x_entry == engine.second->items.end()) {
+                                LOG_ERROR(LOG_VERIFY, "Error: mismatching names! Could not find name '%s' for %s\n", name.c_str(), engine.first.c_str());
+                                outfile << ",,,,";
+                                continue;
+                        }
+
+                        cpp_dec_float_100 E_x = E_x_entry->value;
+                        cpp_dec_float_100 dE_x = (E == 0) ? cpp_dec_float_100(0) : (E_x - E) / E;
+                        outfile << "," << setprecision(100) << fixed << dE_x << "," << log10(abs(dE_x)) << "," << E_x << "," << decimal_accuracy(E, E_x) << flush;
+                }
+                outfile << endl << flush;
         }
         outfile.close();
 }
 
 void print_batch_info(t_batch& batch) {
-        DEBUG_PRINT("X:%d, PX:%d, PBPX:%d, Y:%d, PY:%d\n",
+        LOG_DEBUG(LOG_WORKLOAD, "X:%d, PX:%d, PBPX:%d, Y:%d, PY:%d\n",
                     batch.init.x_size,
                     batch.init.x_padded,
                     batch.init.x_bppadded,
@@ -108,19 +135,19 @@ void print_batch_info(t_batch& batch) {
                     );
 }
 
-// padded read size
-int px(int x, int y) {
-        if (py(y) > PES)     // if feedback fifo is used
+// padded read size, for an array of pes PEs
+int px(int x, int y, int pes) {
+        if (py(y, pes) > pes)     // if feedback fifo is used
         {
-                if (x <= PES) // and x is equal or smaller than number of PES
+                if (x <= pes) // and x is equal or smaller than number of PES
                 {
-                        x = PES + 1; // x will be no. PES + 1, +1 is due to delay in the feedback fifo path
+                        x = pes + 1; // x will be no. PES + 1, +1 is due to delay in the feedback fifo path
                 }
         } else          // feedback fifo is not used
         {
-                if (x < PES) // x is smaller than no. PES
+                if (x < pes) // x is smaller than no. PES
                 {
-                        x = PES; // pad x to be equal to no. PES
+                        x = pes; // pad x to be equal to no. PES
                 }
         }
         return (x);
@@ -130,14 +157,14 @@ int pbp(int x) {
         return ((x / BASE_STEPS + (x % BASE_STEPS != 0)) * BASE_STEPS);
 }
 
-// padded haplotype size
-int py(int y) {
+// padded haplotype size, for an array of pes PEs
+int py(int y, int pes) {
         // divide Y by PES and round up and multiply:
-        return ((y / PES + (y % PES != 0)) * PES);
+        return ((y / pes + (y % pes != 0)) * pes);
 }
 
 t_workload *gen_workload(unsigned long pairs, unsigned long fixedX, unsigned long fixedY) {
-        DEBUG_PRINT("Generating workload for %d pairs, with X=%d and Y=%d\n", (int) pairs, (int) fixedX, (int) fixedY);
+        LOG_DEBUG(LOG_WORKLOAD, "Generating workload for %d pairs, with X=%d and Y=%d\n", (int) pairs, (int) fixedX, (int) fixedY);
         t_workload *workload = (t_workload *) malloc(sizeof(t_workload));
 
         if (fixedY < fixedX) {
@@ -169,8 +196,8 @@ t_workload *gen_workload(unsigned long pairs, unsigned long fixedX, unsigned lon
         }
 
         // Set batch info
-        DEBUG_PRINT("Batch ║ MAX X ║ MAX Y ║ Passes ║\n");
-        DEBUG_PRINT("════════════════════════════════\n");
+        LOG_DEBUG(LOG_WORKLOAD, "Batch ║ MAX X ║ MAX Y ║ Passes ║\n");
+        LOG_DEBUG(LOG_WORKLOAD, "════════════════════════════════\n");
 
         for (int b = 0; b < workload->pairs / PIPE_DEPTH; b++) {
                 int xmax = 0;
@@ -186,12 +213,60 @@ t_workload *gen_workload(unsigned long pairs, unsigned long fixedX, unsigned lon
                 workload->bx[b] = xmax;
                 workload->by[b] = ymax;
 
-                DEBUG_PRINT("%5d ║ %5d ║ %5d ║ %6d ║\n", b, xmax, ymax, PASSES(ymax));
+                LOG_DEBUG(LOG_WORKLOAD, "%5d ║ %5d ║ %5d ║ %6d ║\n", b, xmax, ymax, PASSES(ymax));
         }
 
         return (workload);
 } // gen_workload
 
+/**
+ * Workload of a subset of the batches of another workload, in the given order.
+ */
+t_workload *select_workload(t_workload *workload, const std::vector<int>& batches) {
+        t_workload *sub = (t_workload *) malloc(sizeof(t_workload));
+
+        sub->batches = batches.size();
+        sub->pairs = sub->batches * PIPE_DEPTH;
+
+        sub->hapl = (uint32_t *) malloc(sub->pairs * sizeof(uint32_t));
+        sub->read = (uint32_t *) malloc(sub->pairs * sizeof(uint32_t));
+        sub->bx = (uint32_t *) malloc(sub->batches * sizeof(uint32_t));
+        sub->by = (uint32_t *) malloc(sub->batches * sizeof(uint32_t));
+        sub->bbytes = (size_t *) malloc(sub->batches * sizeof(size_t));
+        sub->cups = 0;
+
+        for (int i = 0; i < sub->batches; i++) {
+                int b = batches[i];
+                sub->bx[i] = workload->bx[b];
+                sub->by[i] = workload->by[b];
+
+                for (int p = 0; p < PIPE_DEPTH; p++) {
+                        sub->hapl[i * PIPE_DEPTH + p] = workload->hapl[b * PIPE_DEPTH + p];
+                        sub->read[i * PIPE_DEPTH + p] = workload->read[b * PIPE_DEPTH + p];
+                        sub->cups += workload->hapl[b * PIPE_DEPTH + p] * workload->read[b * PIPE_DEPTH + p];
+                }
+        }
+
+        return (sub);
+} // select_workload
+
+std::vector<int> all_batches(t_workload *workload) {
+        std::vector<int> selection(workload->batches);
+        for (int i = 0; i < workload->batches; i++) {
+                selection[i] = i;
+        }
+        return (selection);
+} // all_batches
+
+void free_workload(t_workload *workload) {
+        free(workload->hapl);
+        free(workload->read);
+        free(workload->bx);
+        free(workload->by);
+        free(workload->bbytes);
+        free(workload);
+}
+
 void copyProbBytes(t_probs& probs, uint8_t bytesArray[]) {
         int pos = 0;
         for(int i = 0; i < 8; i++) {
@@ -207,16 +282,8 @@ int roundToMultiple(int toRound, int multiple) {
     return toRound - (toRound%multiple);
 }
 
-// From: https://stackoverflow.com/questions/440133/how-do-i-create-a-random-alpha-numeric-string-in-c
-std::string randomBasepairs(int len) {
-    auto randchar = []() -> char
-    {
+unsigned char random_base(uint32_t batch, uint32_t stream, uint32_t position) {
         const char charset[] = "ACTG";
-        const size_t max_index = sizeof(charset) - 1;
-        return charset[rand() % max_index];
-    };
-    std::string str(len, 0);
-    std::generate_n(str.begin(), len, randchar);
-
-    return str;
+        CounterRNG rng(batch, stream, position);
+        return charset[rng.bits(0) & 0x3];
 }
@@ -9,6 +9,9 @@
 #include <time.h>
 #include <sys/time.h>
 #include <posit/posit>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "debug_values.hpp"
 #include "pairhmm_float.hpp"
@@ -23,22 +26,31 @@ cpp_dec_float_100 decimal_accuracy(cpp_dec_float_100 exact, cpp_dec_float_100 co
 
 void writeBenchmark(PairHMMFloat<cpp_dec_float_100> &pairhmm_dec50, PairHMMFloat<float> &pairhmm_float,
                     PairHMMPosit &pairhmm_posit, DebugValues<posit<NBITS, ES>> &hw_debug_values,
-                    std::string filename = "pairhmm_values.txt", bool printDate = true, bool overwrite = false);
+                    std::string filename = "pairhmm_values.txt", bool printDate = true, bool overwrite = false,
+                    const std::vector<std::pair<std::string, DebugValues<double> *> >& extra = {},
+                    const std::string& hw_name = "hw");
 
 void print_batch_info(t_batch& batch);
 
-int px(int x, int y);
+int px(int x, int y, int pes = PES);
 
 int pbp(int x);
 
-int py(int y);
+int py(int y, int pes = PES);
 
 t_workload *gen_workload(unsigned long pairs, unsigned long fixedX, unsigned long fixedY);
 
+t_workload *select_workload(t_workload *workload, const std::vector<int>& batches);
+
+// Selection of all batches of a workload, in order
+std::vector<int> all_batches(t_workload *workload);
+
+void free_workload(t_workload *workload);
+
 void copyProbBytes(t_probs& probs, uint8_t bytesArray[]);
 
 int roundToMultiple(int toRound, int multiple);
 
-std::string randomBasepairs(int len);
+unsigned char random_base(uint32_t batch, uint32_t stream, uint32_t position);
 
 #endif //__UTILS_H
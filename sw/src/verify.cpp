@@ -0,0 +1,159 @@
+#include <stdint.h>
+#include <string.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <iomanip>
+#include <omp.h>
+
+#include "verify.hpp"
+#include "posit_decode.hpp"
+
+using namespace std;
+
+#define POSIT_NAR 0x80000000
+
+uint64_t posit_ulp_distance(uint32_t a, uint32_t b) {
+    if (a == b) {
+        return 0;
+    }
+    if (a == POSIT_NAR || b == POSIT_NAR) {
+        return numeric_limits<uint64_t>::max();
+    }
+    int64_t d = (int64_t) (int32_t) a - (int64_t) (int32_t) b;
+    return (uint64_t) (d < 0 ? -d : d);
+}
+
+static int ulp_bucket(uint64_t ulp) {
+    int bucket = 0;
+    while (ulp > 0 && bucket < ULP_BUCKETS - 1) {
+        ulp >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static bool worse(const t_mismatch& a, const t_mismatch& b) {
+    return a.ulp > b.ulp || (a.ulp == b.ulp && a.rel_err > b.rel_err);
+}
+
+// Keep only the WORST_RESULTS largest mismatches
+static void keep_worst(vector<t_mismatch>& worst) {
+    if (worst.size() > WORST_RESULTS) {
+        partial_sort(worst.begin(), worst.begin() + WORST_RESULTS, worst.end(), worse);
+        worst.resize(WORST_RESULTS);
+    }
+}
+
+t_verify_summary empty_verify_summary() {
+    t_verify_summary summary;
+    summary.results = 0;
+    summary.errors = 0;
+    summary.max_ulp = 0;
+    summary.max_rel_err = 0.0;
+    memset(summary.buckets, 0, sizeof(summary.buckets));
+    return summary;
+}
+
+t_verify_summary verify_results(const uint32_t *sw, const uint32_t *hw, size_t n) {
+    t_verify_summary summary = empty_verify_summary();
+    summary.results = n;
+
+    #pragma omp parallel
+    {
+        uint64_t errors = 0;
+        double max_rel_err = 0.0;
+        uint64_t buckets[ULP_BUCKETS] = {0};
+        vector<t_mismatch> worst;
+
+        #pragma omp for schedule(static) nowait
+        for (size_t k = 0; k < n; k++) {
+            uint64_t ulp = posit_ulp_distance(sw[k], hw[k]);
+            buckets[ulp_bucket(ulp)]++;
+
+            if (ulp == 0) {
+                continue;
+            }
+
+            double s = decode_posit(sw[k]);
+            double h = decode_posit(hw[k]);
+            double rel_err = (s == 0.0) ? numeric_limits<double>::infinity() : fabs((h - s) / s);
+            if (!(rel_err <= ERROR_MARGIN)) {
+                errors++;
+            }
+            max_rel_err = max(max_rel_err, rel_err);
+
+            t_mismatch m = {(uint32_t) (k / PIPE_DEPTH), (uint32_t) (k % PIPE_DEPTH), sw[k], hw[k], ulp, rel_err};
+            worst.push_back(m);
+            if (worst.size() >= 2 * WORST_RESULTS) {
+                keep_worst(worst);
+            }
+        }
+
+        keep_worst(worst);
+
+        #pragma omp critical
+        {
+            summary.errors += errors;
+            summary.max_rel_err = max(summary.max_rel_err, max_rel_err);
+            for (int b = 0; b < ULP_BUCKETS; b++) {
+                summary.buckets[b] += buckets[b];
+            }
+            summary.worst.insert(summary.worst.end(), worst.begin(), worst.end());
+        }
+    }
+
+    keep_worst(summary.worst);
+    sort(summary.worst.begin(), summary.worst.end(), worse);
+    if (!summary.worst.empty()) {
+        summary.max_ulp = summary.worst[0].ulp;
+    }
+
+    return summary;
+}
+
+void merge_verify_summary(t_verify_summary& summary, const t_verify_summary& part, uint32_t batch_offset) {
+    summary.results += part.results;
+    summary.errors += part.errors;
+    summary.max_ulp = max(summary.max_ulp, part.max_ulp);
+    summary.max_rel_err = max(summary.max_rel_err, part.max_rel_err);
+    for (int b = 0; b < ULP_BUCKETS; b++) {
+        summary.buckets[b] += part.buckets[b];
+    }
+
+    for (t_mismatch m : part.worst) {
+        m.batch += batch_offset;
+        summary.worst.push_back(m);
+    }
+    keep_worst(summary.worst);
+    sort(summary.worst.begin(), summary.worst.end(), worse);
+}
+
+void print_verify_summary(const t_verify_summary& summary, std::ostream& out) {
+    out << "Verified " << summary.results << " results, " << summary.errors
+        << " above relative error " << ERROR_MARGIN << endl;
+    out << "Max ULP distance: " << summary.max_ulp << ", max relative error: "
+        << scientific << summary.max_rel_err << defaultfloat << endl;
+
+    out << "ULP distance histogram:" << endl;
+    for (int b = 0; b < ULP_BUCKETS; b++) {
+        if (summary.buckets[b] == 0) {
+            continue;
+        }
+        if (b == 0) {
+            out << setw(24) << "0";
+        } else {
+            out << setw(10) << (1ULL << (b - 1)) << " ... " << setw(9) << ((1ULL << b) - 1);
+        }
+        out << " : " << summary.buckets[b] << endl;
+    }
+
+    if (!summary.worst.empty()) {
+        out << "Worst results:" << endl;
+        for (const t_mismatch& m : summary.worst) {
+            out << "result[" << m.batch << "][" << m.pair << "] SW: " << hex << setw(8) << setfill('0') << m.sw
+                << ", HW: " << setw(8) << m.hw << dec << setfill(' ')
+                << ", ULP: " << m.ulp << ", rel. err: " << scientific << m.rel_err << defaultfloat << endl;
+        }
+    }
+}
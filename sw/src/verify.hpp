@@ -0,0 +1,53 @@
+#ifndef __VERIFY_H
+#define __VERIFY_H
+
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+
+#include "defines.hpp"
+
+// Bucket 0 holds exact matches, bucket k holds ULP distances in [2^(k-1), 2^k)
+#define ULP_BUCKETS      34
+
+// Number of worst results kept for the summary
+#define WORST_RESULTS    10
+
+typedef struct struct_mismatch {
+    uint32_t batch;
+    uint32_t pair;
+    uint32_t sw;
+    uint32_t hw;
+    uint64_t ulp;
+    double rel_err;
+} t_mismatch;
+
+typedef struct struct_verify_summary {
+    uint64_t results;
+    uint64_t errors;            // Results with a relative error above ERROR_MARGIN
+    uint64_t max_ulp;
+    double max_rel_err;
+    uint64_t buckets[ULP_BUCKETS];
+    std::vector<t_mismatch> worst;
+} t_verify_summary;
+
+// Distance in units in the last place between two raw posits. Posits are
+// ordered like two's complement integers, so this is an integer difference.
+// NaR never matches anything but NaR.
+uint64_t posit_ulp_distance(uint32_t a, uint32_t b);
+
+/**
+ * Compare the raw posit results of the host (sw) and the accelerator (hw),
+ * both in batch order (batch * PIPE_DEPTH + pair), in parallel.
+ */
+t_verify_summary verify_results(const uint32_t *sw, const uint32_t *hw, size_t n);
+
+// Summary of zero results, to merge others into
+t_verify_summary empty_verify_summary();
+
+// Add the counts and worst results of part, whose batch numbers start at batch_offset, to summary
+void merge_verify_summary(t_verify_summary& summary, const t_verify_summary& part, uint32_t batch_offset);
+
+void print_verify_summary(const t_verify_summary& summary, std::ostream& out);
+
+#endif //__VERIFY_H